@@ -0,0 +1,29 @@
+/*
+ * time to load a map and a scenario, best of several runs
+ * usage: bench_instance_load MAP SCEN N [RUNS]
+ */
+#include <lacam.hpp>
+
+using namespace lacam;
+
+int main(int argc, char *argv[])
+{
+  if (argc < 4) {
+    std::cerr << "usage: " << argv[0] << " MAP SCEN N [RUNS]" << std::endl;
+    return 1;
+  }
+  const std::string map_filename = argv[1];
+  const std::string scen_filename = argv[2];
+  const auto N = std::stoi(argv[3]);
+  const auto runs = argc > 4 ? std::stoi(argv[4]) : 10;
+
+  auto best = std::numeric_limits<double>::max();
+  for (auto k = 0; k < runs; ++k) {
+    const auto deadline = Deadline();
+    const auto ins = Instance(scen_filename, map_filename, N);
+    best = std::min(best, deadline.elapsed_ns() / 1e6);
+    if (!ins.is_valid(1)) return 1;
+  }
+  std::cout << "instance_load_ms=" << best << std::endl;
+  return 0;
+}
@@ -0,0 +1,74 @@
+/*
+ * PIBT for several configurations at once, on a single thread
+ *
+ * K rollouts from the same configuration advance in lockstep, agent by agent
+ * in the priority order. Occupancy is stored as K lanes per vertex, and
+ * candidate distances of each agent are fetched once per call
+ * and shared by all lanes. Lane k draws the same random numbers as
+ * PIBT(ins, D, seed, scatter, allow_following, first_stream + k), hence
+ * yields the same configuration.
+ */
+#pragma once
+#include "dist_table.hpp"
+#include "graph.hpp"
+#include "instance.hpp"
+#include "scatter.hpp"
+#include "utils.hpp"
+
+namespace lacam
+{
+
+  struct BatchedPIBT {
+    const Instance *ins;
+    const int N;  // number of agents
+    const int V_size;
+    const int K;  // number of lanes
+    DistTableMultiGoal *D;
+    std::vector<RNG> MTs_calls;  // lane -> random stream, seeding MTs per call
+    std::vector<RNG> MTs;        // lane -> tie-breakers of the current call
+
+    const int NO_AGENT;
+    std::vector<int> occupied_now;   // vertex -> agent, common to all lanes
+    std::vector<int> occupied_next;  // vertex * K + lane -> agent
+    std::vector<Vertex *> Q_next;                 // agent * K + lane
+    std::vector<std::array<Vertex *, 5>> C_next;  // agent * K + lane
+
+    // sorting keys without tie-breakers, per agent and shared by lanes
+    std::vector<std::array<float, 5>> base_keys;
+    std::vector<int> base_keys_stamp;  // agent -> call that set base_keys
+    int stamp;
+
+    // callers waiting on priority inheritance, reused by all lanes
+    struct Frame {
+      int i;               // agent
+      int k;               // index of the candidate being tried
+      int num_candidates;  // size of C_next in use
+    };
+    std::vector<Frame> inheritance;
+
+    Scatter *scatter;
+    bool allow_following;
+
+    BatchedPIBT(const Instance *_ins, DistTableMultiGoal *_D, const int _K,
+                int seed = 0, Scatter *_scatter = nullptr,
+                bool _allow_following = false, int first_stream = 0);
+    ~BatchedPIBT();
+
+    // Q_tos are K configurations, constraints (non-null entries) are taken
+    // from Q_tos[0] and shared by all lanes; success is set per lane
+    void set_new_configs(const Config &Q_from, std::vector<Config> &Q_tos,
+                         const std::vector<int> &order,
+                         std::vector<bool> &success);
+
+    // specialized on allow_following, chosen once at construction
+    bool (BatchedPIBT::*funcPIBT_impl)(const int, const int, const Config &);
+    template <bool ALLOW_FOLLOWING>
+    bool funcPIBT(const int lane, const int i_root, const Config &Q_from);
+    template <bool ALLOW_FOLLOWING>
+    int set_candidates(const int lane, const int i, const int i_caller,
+                       const Config &Q_from);
+    const std::array<float, 5> &get_base_keys(const int i,
+                                              const Config &Q_from);
+  };
+
+}  // namespace lacam
@@ -0,0 +1,39 @@
+/*
+ * open-addressing hash table of explored high-level nodes
+ */
+#pragma once
+
+#include "hnode.hpp"
+
+namespace lacam
+{
+
+  // keys are not copied, configurations are read from the stored nodes;
+  // the cached hash is compared first, and used again when growing
+  struct ExploredTable {
+    struct Slot {
+      uint hash;
+      HNode *node;  // nullptr -> empty
+    };
+
+    std::vector<Slot> slots;  // size is a power of two
+    size_t num_entries;
+
+    ExploredTable(size_t initial_capacity = 1024);
+
+    HNode *find(const PackedConfig &C) const;  // nullptr if not found
+    void insert(HNode *H);  // H->C must be absent from the table
+    size_t size() const { return num_entries; }
+
+    template <typename F>
+    void for_each(F &&f) const
+    {
+      for (auto &slot : slots)
+        if (slot.node != nullptr) f(slot.node);
+    }
+
+  private:
+    void grow();
+  };
+
+}  // namespace lacam
@@ -3,18 +3,39 @@
  */
 #pragma once
 #include <iterator>
+#include <memory>
 
 #include "utils.hpp"
 
 namespace lacam
 {
 
+  struct Vertex;
+
+  // contiguous range of vertices, a view into the adjacency of Graph
+  struct VertexSpan {
+    Vertex *const *first;
+    Vertex *const *last;
+
+    VertexSpan() : first(nullptr), last(nullptr) {}
+    VertexSpan(Vertex *const *_first, Vertex *const *_last)
+        : first(_first), last(_last)
+    {
+    }
+    Vertex *const *begin() const { return first; }
+    Vertex *const *end() const { return last; }
+    size_t size() const { return last - first; }
+    bool empty() const { return first == last; }
+    Vertex *operator[](const size_t k) const { return first[k]; }
+  };
+
   struct Vertex {
     const int id;     // index for V in Graph
     const int index;  // index for U (width * y + x) in Graph
     const int x;
     const int y;
-    std::vector<Vertex *> neighbor;
+    VertexSpan neighbor;
+    VertexSpan candidates;  // neighbor followed by the vertex itself
 
     Vertex(int _id, int _index, int _x, int _y);
 
@@ -24,18 +45,20 @@ namespace lacam
   class Config : public std::vector<Vertex *>
   {
   public:
-    Config() : std::vector<Vertex *>(), goal_indices() {}
+    Config() : std::vector<Vertex *>(), goal_indices(), hash(0) {}
     Config(const int N, Vertex *v)
-        : std::vector<Vertex *>(N, v), goal_indices(N, 0)
+        : std::vector<Vertex *>(N, v), goal_indices(N, 0), hash(0)
     {
     }
     Config(const std::initializer_list<Vertex *> vertices)
-        : std::vector<Vertex *>(vertices), goal_indices(vertices.size(), 0)
+        : std::vector<Vertex *>(vertices),
+          goal_indices(vertices.size(), 0),
+          hash(0)
     {
     }
     Config(const std::initializer_list<Vertex *> vertices,
            const std::initializer_list<int> goal_indices)
-        : std::vector<Vertex *>(vertices), goal_indices(goal_indices)
+        : std::vector<Vertex *>(vertices), goal_indices(goal_indices), hash(0)
     {
     }
 
@@ -60,23 +83,86 @@ namespace lacam
     }
 
     std::vector<int> goal_indices;
+    uint hash;  // Zobrist hash, see zobrist_hash; maintained by the user
   };
   std::ostream &operator<<(std::ostream &os, const Config &c);
   using Path = std::vector<Vertex *>;  // path
   using Paths = std::vector<Path>;
 
   struct Graph {
+    // number vertices along a Hilbert curve instead of the scan order,
+    // so that spatially close vertices are close in vertex-indexed arrays
+    static bool FLG_HILBERT_ORDER;
+    // false -> the previous layout, with each vertex and its adjacency
+    // allocated separately; kept for comparison
+    static bool FLG_CSR_LAYOUT;
+
     Vertices V;  // without nullptr
     Vertices U;  // with nullptr, i.e., |U| = width * height
     int width;   // grid width
     int height;  // grid height
+
+    // CSR layout; vertex records are contiguous, and the range
+    // [adj_offset[k], adj_offset[k+1]) of adj lists the neighbors of V[k]
+    // followed by k itself
+    std::vector<Vertex> vertices;  // pointed to by V and U
+    std::vector<int> adj_offset;
+    std::vector<int> adj;          // vertex ids
+    std::vector<Vertex *> adj_ptr;  // the same as adj, backs VertexSpan
+
+    // the previous layout; adj and adj_offset are still built
+    std::vector<std::unique_ptr<Vertex>> scattered_vertices;
+    std::vector<std::unique_ptr<Vertex *[]>> scattered_adj;
+
     Graph();
     Graph(const std::string &filename);  // taking map filename
     ~Graph();
+    Graph(const Graph &) = delete;
+    Graph &operator=(const Graph &) = delete;
 
     int size() const;  // the number of vertices, |V|
   };
 
+  // compact configuration used in the search;
+  // vertex id and goal index of each agent are packed into one 32-bit word
+  struct PackedConfig {
+    static constexpr int GOAL_INDEX_BITS = 10;
+    static constexpr uint32_t GOAL_INDEX_MASK = (1u << GOAL_INDEX_BITS) - 1;
+    static constexpr int MAX_VERTICES = 1 << (32 - GOAL_INDEX_BITS);
+    static constexpr int MAX_GOAL_INDEX = GOAL_INDEX_MASK;
+
+    std::vector<uint32_t> body;
+    uint hash;  // same as the Zobrist hash of the original Config
+
+    PackedConfig() : body(), hash(0) {}
+    explicit PackedConfig(const Config &C) : body(), hash(0) { pack(C); }
+
+    static inline uint32_t encode(const int v_id, const int goal_index)
+    {
+      return ((uint32_t)v_id << GOAL_INDEX_BITS) | (uint32_t)goal_index;
+    }
+    inline int vertex_id(const int i) const
+    {
+      return body[i] >> GOAL_INDEX_BITS;
+    }
+    inline int goal_index(const int i) const
+    {
+      return body[i] & GOAL_INDEX_MASK;
+    }
+    inline size_t size() const { return body.size(); }
+
+    void pack(const Config &C);  // C.hash must be valid
+    void unpack(const Graph *G, Config &C) const;
+
+    bool operator==(const PackedConfig &C) const
+    {
+      return hash == C.hash && body.size() == C.body.size() &&
+             std::memcmp(body.data(), C.body.data(),
+                         body.size() * sizeof(uint32_t)) == 0;
+    }
+    bool operator!=(const PackedConfig &C) const { return !(*this == C); }
+  };
+
   inline int manhattanDist(Vertex *a, Vertex *b)
   {
     return std::abs(a->x - b->x) + std::abs(a->y - b->y);
@@ -87,18 +173,47 @@ namespace lacam
       const Config &C2);  // check equivalence of two configurations
 
   bool enough_goals_reached(const Config &C, const int threshold);
+  bool enough_goals_reached(const PackedConfig &C, const int threshold);
 
-  // hash function of configuration
-  // c.f.
-  // https://stackoverflow.com/questions/10405030/c-unordered-map-fail-when-used-with-a-vector-as-key
+  // Zobrist-style key of a single agent state;
+  // the hash of a configuration is the XOR of the keys of all agents,
+  // hence it can be updated incrementally for agents that changed
+  inline uint zobrist_key(const int i, const int v_id, const int goal_index)
+  {
+    // splitmix64 finalizer
+    uint64_t x = (uint64_t)i * 0x9e3779b97f4a7c15ULL +
+                 (uint64_t)v_id * 0xc2b2ae3d27d4eb4fULL +
+                 (uint64_t)goal_index * 0x165667b19e3779f9ULL;
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return (uint)x;
+  }
+  inline uint zobrist_key(const int i, const Vertex *v, const int goal_index)
+  {
+    return zobrist_key(i, v->id, goal_index);
+  }
+  uint zobrist_hash(const Config &C);  // from scratch, O(N)
+
+  // hash function of configuration, using the cached Zobrist hash
   struct ConfigHasher {
     uint operator()(const Config &C) const;
   };
+  struct PackedConfigHasher {
+    uint operator()(const PackedConfig &C) const { return C.hash; }
+  };
 
   std::ostream &operator<<(std::ostream &os, const Vertex *v);
   std::ostream &operator<<(std::ostream &os, const Config &Q);
+  std::ostream &operator<<(std::ostream &os, const PackedConfig &Q);
   std::ostream &operator<<(std::ostream &os, const Paths &paths);
 
   bool has_following_conflict(const Config &c_from, const Config &c_to);
+  // occupied: vertex-indexed scratch, all -1 before and after the call
+  bool has_following_conflict(const PackedConfig &c_from,
+                              const PackedConfig &c_to,
+                              std::vector<int> &occupied);
 
 }  // namespace lacam
@@ -16,6 +16,7 @@ namespace lacam
 
     Heuristic(const Instance *_ins, DistTableMultiGoal *_D);
     int get(const Config &C) const;
+    int get(const PackedConfig &C) const;
   };
 
 }  // namespace lacam
@@ -10,18 +10,20 @@
 namespace lacam
 {
 
-  // high-level search node
   struct HNode;
-  struct CompareHNodePointers {  // for determinism
-    bool operator()(const HNode *lhs, const HNode *rhs) const;
+  struct HEdge {
+    HNode *to;
+    bool feasible;  // the transition is valid, cached at creation
   };
 
+  // high-level search node
   struct HNode {
     static int COUNT;
 
-    const Config C;
+    const int id;  // dense per-planner id
+    const PackedConfig C;
     HNode *parent;
-    std::set<HNode *, CompareHNodePointers> neighbor;
+    std::vector<HEdge> neighbor;  // sorted by id, for determinism
 
     // value
     int g;
@@ -31,13 +33,27 @@ namespace lacam
     // for low-level search
     std::vector<float> priorities;
     std::vector<int> order;
-    std::queue<LNode *> search_tree;
+    // arena of low-level nodes in BFS order;
+    // nodes from search_tree_head on are the queue of the low-level search
+    std::deque<LNode> search_tree;
+    size_t search_tree_head;
 
-    HNode(Config _C, DistTableMultiGoal *D, HNode *_parent = nullptr,
-          int _g = 0, int _h = 0);
+    HNode(const PackedConfig &_C, DistTableMultiGoal *D,
+          HNode *_parent = nullptr, int _g = 0, int _h = 0, int _id = 0);
     ~HNode();
 
-    LNode *get_next_lowlevel_node(std::mt19937 &MT);
+    bool is_neighbor(const HNode *H) const;
+    void add_neighbor(HNode *H, const bool feasible);
+
+    LNode *get_next_lowlevel_node(RNG &MT, const Graph *G,
+                                  DistTableMultiGoal *D);
+    void set_priorities(DistTableMultiGoal *D);  // priorities and order
+
+    // free the low-level search tree and per-agent arrays;
+    // with restart, an unfinished low-level search starts over when visited
+    // again
+    void release_lowlevel(const bool restart);
+    size_t lowlevel_bytes() const;
   };
   using HNodes = std::vector<HNode *>;
 
@@ -41,6 +41,7 @@ namespace lacam
     int get_total_goals() const;
 
     bool is_goal_config(const Config &C) const;
+    bool is_goal_config(const PackedConfig &C) const;
   };
 
   // solution: a sequence of configurations
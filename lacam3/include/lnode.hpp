@@ -8,15 +8,18 @@
 namespace lacam
 {
 
-  // low-level search node
+  // low-level search node;
+  // a node stores one constraint, i.e., who goes where, and its parent link
+  // the full set of constraints is obtained by walking up to the root
   struct LNode {
     static int COUNT;
 
-    std::vector<int> who;
-    Vertices where;
+    const LNode *parent;
+    const int who;
+    Vertex *const where;
     const int depth;
     LNode();
-    LNode(LNode *parent, int i, Vertex *v);  // who and where
+    LNode(const LNode *_parent, int i, Vertex *v);  // who and where
     ~LNode();
   };
 
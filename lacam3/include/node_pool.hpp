@@ -0,0 +1,71 @@
+/*
+ * slab pool for search nodes
+ */
+#pragma once
+
+#include "utils.hpp"
+
+namespace lacam
+{
+
+  // node objects are carved out of large slabs and live until the pool is
+  // destroyed, which releases all slabs at once; members owning heap memory
+  // (e.g., vectors in HNode) still allocate on their own
+  template <typename T>
+  struct NodePool {
+    const size_t slab_size;  // number of objects per slab
+    std::vector<T *> slabs;
+    size_t slab_used;  // used slots in the last slab
+
+    // statistics
+    size_t num_created;
+    size_t num_live;
+
+    NodePool(size_t _slab_size = 1024)
+        : slab_size(_slab_size),
+          slabs(),
+          slab_used(_slab_size),
+          num_created(0),
+          num_live(0)
+    {
+    }
+
+    // note: destructors of live objects are not called here
+    ~NodePool()
+    {
+      for (auto slab : slabs) std::allocator<T>().deallocate(slab, slab_size);
+    }
+
+    NodePool(const NodePool &) = delete;
+    NodePool &operator=(const NodePool &) = delete;
+
+    template <typename... Args>
+    T *create(Args &&...args)
+    {
+      if (slab_used == slab_size) {
+        slabs.push_back(std::allocator<T>().allocate(slab_size));
+        slab_used = 0;
+      }
+      T *p = slabs.back() + slab_used;
+      ++slab_used;
+      new (p) T(std::forward<Args>(args)...);
+      ++num_created;
+      ++num_live;
+      return p;
+    }
+
+    // for teardown; the slot is released with the pool
+    void dispose(T *p)
+    {
+      if (p == nullptr) return;
+      p->~T();
+      --num_live;
+    }
+
+    size_t bytes() const
+    {
+      return slabs.size() * slab_size * sizeof(T);
+    }
+  };
+
+}  // namespace lacam
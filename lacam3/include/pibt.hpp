@@ -7,6 +7,9 @@
  * Artificial Intelligence (AIJ). 2022.
  */
 #pragma once
+
+#include <atomic>
+
 #include "dist_table.hpp"
 #include "graph.hpp"
 #include "instance.hpp"
@@ -18,7 +21,10 @@ namespace lacam
 
   struct PIBT {
     const Instance *ins;
-    std::mt19937 MT;
+    const int id;  // stream number, also used to rank equal candidates
+    RNG MT_calls;  // seeds MT at each call, so that a cancelled call does not
+                   // shift the random numbers of later calls
+    RNG MT;
 
     // solver utils
     const int N;  // number of agents
@@ -30,7 +36,14 @@ namespace lacam
     std::vector<int> occupied_now;   // for quick collision checking
     std::vector<int> occupied_next;  // for quick collision checking
     std::vector<std::array<Vertex *, 5>> C_next;  // next location candidates
-    std::vector<float> tie_breakers;              // random values, used in PIBT
+
+    // callers waiting on priority inheritance, instead of recursion
+    struct Frame {
+      int i;               // agent
+      int k;               // index of the candidate being tried
+      int num_candidates;  // size of C_next[i] in use
+    };
+    std::vector<Frame> inheritance;
 
     // scatter
     Scatter *scatter;
@@ -38,14 +51,60 @@ namespace lacam
     // whether following conflicts are allowed
     bool allow_following;
 
+    // cooperative cancellation among PIBTs generating candidates for the same
+    // configuration; the best one, i.e., minimum (f, id), is kept in an atomic
+    struct Cancellation {
+      std::atomic<uint64_t> best;
+
+      Cancellation() : best(UINT64_MAX) {}
+      static uint64_t pack(const int f, const int id)
+      {
+        return (uint64_t(f) << 32) | uint32_t(id);
+      }
+      void reset() { best.store(UINT64_MAX, std::memory_order_relaxed); }
+      void update(const int f, const int id);
+      void cancel_all() { best.store(0, std::memory_order_relaxed); }
+      // whether f_lb, a lower bound of f, cannot win anymore;
+      // (f, id) of another candidate never equals, and cancel_all sets zero
+      bool is_hopeless(const int f_lb, const int id) const
+      {
+        return pack(f_lb, id) >= best.load(std::memory_order_relaxed);
+      }
+    };
+    Cancellation *cancellation;     // shared, nullptr -> run to completion
+    std::vector<int> lower_bounds;  // agent -> lower bound of its part of f
+    std::vector<int> settled;       // agents fixed in the current chain
+
     PIBT(const Instance *_ins, DistTableMultiGoal *_D, int seed = 0,
-         Scatter *_scatter = nullptr, bool _allow_following = false);
+         Scatter *_scatter = nullptr, bool _allow_following = false,
+         int stream = 0);
     ~PIBT();
 
     bool set_new_config(const Config &Q_from, Config &Q_to,
                         const std::vector<int> &order);
     bool funcPIBT(const int i, const int i_caller, const Config &Q_from,
                   Config &Q_to);
+
+    // specialized on allow_following and the use of scatter,
+    // chosen once at construction
+    bool (PIBT::*set_new_config_impl)(const Config &, Config &,
+                                      const std::vector<int> &);
+    bool (PIBT::*funcPIBT_impl)(const int, const int, const Config &,
+                                Config &);
+    template <bool ALLOW_FOLLOWING, bool USE_SCATTER>
+    void bind();
+    template <bool ALLOW_FOLLOWING, bool USE_SCATTER>
+    bool set_new_config_specialized(const Config &Q_from, Config &Q_to,
+                                    const std::vector<int> &order);
+    template <bool ALLOW_FOLLOWING, bool USE_SCATTER>
+    bool funcPIBT_specialized(const int i, const int i_caller,
+                              const Config &Q_from, Config &Q_to);
+    template <bool ALLOW_FOLLOWING, bool USE_SCATTER>
+    int set_candidates(const int i, const int i_caller, const Config &Q_from);
+    // part of agent i in Planner::get_edge_cost + Heuristic::get
+    int get_cost(const int i, const Config &Q_from, const Config &Q_to);
+    int get_cost_lower_bound(const int i, const Config &Q_from,
+                             const Config &Q_to);
     int is_swap_required_and_possible(const int ai, const Config &Q_from,
                                       Config &Q_to);
     bool is_swap_required(const int pusher, const int puller, const Config &Q,
@@ -19,25 +19,33 @@
 #include <optional>
 
 #include "dist_table.hpp"
+#include "explored_table.hpp"
 #include "graph.hpp"
 #include "heuristic.hpp"
 #include "hnode.hpp"
 #include "instance.hpp"
+#include "node_pool.hpp"
+#include "batched_pibt.hpp"
 #include "pibt.hpp"
 #include "refiner.hpp"
 #include "scatter.hpp"
+#include "thread_pool.hpp"
 #include "translator.hpp"
 #include "utils.hpp"
 
 namespace lacam
 {
 
+  // update goal indices and hash of c, moving from prev_config
+  void calculate_goal_indices(const Instance *ins, Config &c,
+                              const Config &prev_config);
+
   struct Planner {
     const Instance *ins;
     const std::optional<int> threshold;
     const Deadline *deadline;
     const int seed;
-    std::mt19937 MT;
+    RNG MT;
     const int verbose;
     const int depth;
 
@@ -55,17 +63,40 @@ namespace lacam
 
     // configuration generator
     std::vector<PIBT *> pibts;
+    BatchedPIBT *batched_pibt;  // replaces pibts with FLG_BATCHED_PIBT
+    PIBT::Cancellation cancellation;  // best candidate so far among pibts
+    ThreadPool *worker_pool;  // for Monte-Carlo PIBT, shared with recursion
+    bool delete_worker_pool_after_used;
 
     // for refiner
-    int seed_refiner;
+    int seed_refiner;  // refiner id
+    RNG MT_refiner;    // jumped once per refiner, after the streams of PIBTs
     std::list<std::future<Solution>> refiner_pool;
 
     // for search utils
     std::deque<HNode *> OPEN;
-    std::unordered_map<Config, HNode *, ConfigHasher> EXPLORED;
+    ExploredTable EXPLORED;
     HNode *H_init;  // start node
     HNode *H_goal;  // goal node
 
+    // node storage, released in bulk
+    NodePool<HNode> hnode_pool;
+
+    // scratch buffers of the search loop, reused across iterations
+    Config Q_from;  // unpacked configuration of the node being expanded
+    Config Q_to;
+    PackedConfig Q_to_packed;
+    std::vector<Config> Q_cands;  // worker-id -> configuration
+    std::vector<int> f_vals;      // worker-id -> f-value
+    std::vector<bool> lane_success;  // for batched PIBT
+    std::vector<HNode *> rewrite_queue;
+    std::vector<int> occupied;  // vertex-indexed, for following conflicts
+
+    // for memory-bounded search
+    size_t lowlevel_bytes;  // low-level trees and per-agent arrays
+    bool memory_limit_reached;
+    int num_memory_reductions;  // calls of reduce_memory_usage
+
     // parameters
     static bool FLG_STAR;  // whether to refine solutions after initial solution
                            // discovery
@@ -73,6 +104,8 @@ namespace lacam
     static int SCATTER_MARGIN;  // used in SUO
     static int PIBT_NUM;  // number of PIBT run, i.e., Monte-Carlo configuration
                           // generator
+    static bool FLG_BATCHED_PIBT;  // run PIBT_NUM rollouts in lockstep on one
+                                   // thread, instead of PIBT_NUM threads
     static bool FLG_REFINER;  // whether to use refiners
     static int REFINER_NUM;   // number of refiners
     static bool
@@ -84,6 +117,7 @@ namespace lacam
     static float RECURSIVE_RATE;
     static double RECURSIVE_TIME_LIMIT;
     static bool FLG_ALLOW_FOLLOWING;
+    static size_t MEMORY_LIMIT;  // bytes of the search, 0 -> unlimited
 
     // for logging
     static int CHECKPOINTS_DURATION;
@@ -97,21 +131,28 @@ namespace lacam
     Planner(const Instance *_ins, std::optional<int> _threshold = std::nullopt,
             int _verbose = 0, const Deadline *_deadline = nullptr,
             int _seed = 0,
-            int _depth = 0,                   // used in recursive LaCAM
-            DistTableMultiGoal *_D = nullptr  // used in recursive LaCAM
+            int _depth = 0,                    // used in recursive LaCAM
+            DistTableMultiGoal *_D = nullptr,  // used in recursive LaCAM
+            ThreadPool *_worker_pool = nullptr  // used in recursive LaCAM
     );
     ~Planner();
     Solution solve();
     bool set_new_config(HNode *S, LNode *M, Config &Q_to);
-    HNode *create_highlevel_node(const Config &Q, HNode *parent);
+    HNode *create_highlevel_node(const PackedConfig &Q, HNode *parent);
+    void release_lowlevel(HNode *H, const bool restart);
+    size_t get_memory_usage() const;
+    bool reduce_memory_usage();
+    void add_edge(HNode *H_from, HNode *H_to);
     void rewrite(HNode *H_from, HNode *H_to);
     int get_edge_cost(const Config &C1, const Config &C2);
+    int get_edge_cost(const PackedConfig &C1, const PackedConfig &C2);
     Solution backtrack(HNode *H);
     void apply_new_solution(const Solution &plan);
     void set_scatter();
     void set_pibt();
     void set_refiner();
-    Solution get_refined_plan(const Solution &plan_origin);
+    Solution get_refined_plan(const Solution &plan_origin,
+                              const int refiner_id, RNG MT_internal);
     void update_checkpoints();
     void logging();
   };
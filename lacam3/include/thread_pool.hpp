@@ -0,0 +1,63 @@
+/*
+ * persistent worker threads, used for Monte-Carlo configuration generation
+ * and for the distance table setup
+ */
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "utils.hpp"
+
+namespace lacam
+{
+
+  struct ThreadPool {
+    // a set of tasks, fn(0), ..., fn(n-1), living on the caller's stack
+    struct Batch {
+      void (*invoke)(void *, int);
+      void *fn;
+      const int n;
+      int next;  // next task to be claimed, protected by the pool mutex
+      std::atomic<int> done;
+
+      Batch(void (*_invoke)(void *, int), void *_fn, int _n)
+          : invoke(_invoke), fn(_fn), n(_n), next(0), done(0)
+      {
+      }
+    };
+
+    std::vector<std::thread> workers;
+    std::vector<Batch *> pending;  // batches with unclaimed tasks
+    std::mutex mtx;
+    std::condition_variable cv_task;
+    std::condition_variable cv_done;
+    bool stop;
+
+    ThreadPool(int num_workers, bool pin_to_cores = true);
+    ~ThreadPool();
+
+    // execute fn(k) for k in [0, n) and wait for all;
+    // the caller participates, hence multiple callers can share the pool
+    template <typename F>
+    void run(const int n, F &&fn)
+    {
+      using Fn = std::remove_reference_t<F>;
+      auto batch = Batch(
+          [](void *f, int k) { (*static_cast<Fn *>(f))(k); },
+          static_cast<void *>(std::addressof(fn)), n);
+      execute(&batch);
+    }
+
+    int size() const { return workers.size(); }
+
+  private:
+    void execute(Batch *batch);
+    bool claim(Batch *batch, int &k);  // requires lock
+    void work(Batch *batch, int k);
+    void worker_loop();
+  };
+
+}  // namespace lacam
@@ -7,10 +7,13 @@
 #include <array>
 #include <chrono>
 #include <climits>
+#include <cstdint>
+#include <cstring>
 #include <fstream>
 #include <future>
 #include <iomanip>
 #include <iostream>
+#include <limits>
 #include <list>
 #include <map>
 #include <numeric>
@@ -20,6 +23,7 @@
 #include <set>
 #include <stack>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
@@ -42,10 +46,52 @@ namespace lacam
   double elapsed_ns(const Deadline *deadline);
   bool is_expired(const Deadline *deadline);
 
-  float get_random_float(std::mt19937 &MT, float from = 0, float to = 1);
-  float get_random_float(std::mt19937 *MT, float from = 0, float to = 1);
-  int get_random_int(std::mt19937 &MT, int from = 0, int to = 1);
-  int get_random_int(std::mt19937 *MT, int from = 0, int to = 1);
+  // xoshiro256**, seeded by splitmix64;
+  // streams of the same seed are 2^128 draws apart from each other
+  struct RNG {
+    using result_type = uint64_t;
+    uint64_t s[4];
+
+    RNG(const uint64_t seed = 0, const int stream = 0);
+    void jump();  // skip 2^128 draws
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return UINT64_MAX; }
+    result_type operator()()
+    {
+      const auto res = rotl(s[1] * 5, 7) * 9;
+      const auto t = s[1] << 17;
+      s[2] ^= s[0];
+      s[3] ^= s[1];
+      s[1] ^= s[2];
+      s[0] ^= s[3];
+      s[2] ^= t;
+      s[3] = rotl(s[3], 45);
+      return res;
+    }
+
+    // uniform in [0, 1), from 24 bits
+    float get_float() { return (operator()() >> 40) * 0x1.0p-24f; }
+    // bulk version, two values per draw
+    void get_floats(float *out, const int n)
+    {
+      for (auto k = 0; k < n; k += 2) {
+        const auto x = operator()();
+        out[k] = (x >> 40) * 0x1.0p-24f;
+        if (k + 1 < n) out[k + 1] = ((x >> 8) & 0xffffff) * 0x1.0p-24f;
+      }
+    }
+
+    static uint64_t rotl(const uint64_t x, const int k)
+    {
+      return (x << k) | (x >> (64 - k));
+    }
+  };
+
+  float get_random_float(RNG &MT, float from = 0, float to = 1);
+  float get_random_float(RNG *MT, float from = 0, float to = 1);
+  int get_random_int(RNG &MT, int from = 0, int to = 1);
+  int get_random_int(RNG *MT, int from = 0, int to = 1);
 
   template <typename Head, typename... Tail>
   void info(const int level, const int verbose, Head &&head, Tail &&...tail);
@@ -75,4 +121,25 @@ namespace lacam
 
   uint hash_two_ints(uint a, uint b);
 
+  long get_peak_rss_kb();  // peak resident set size of the process
+
+  // read-only memory-mapped file, data == nullptr on failure
+  struct MappedFile {
+    const char *data;
+    size_t size;
+
+    MappedFile(const std::string &filename);
+    ~MappedFile();
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+  };
+
+  // for hand-written parsers
+  // take the first line off buf, without "\n" and the "\r" of CRLF
+  bool pop_line(std::string_view &buf, std::string_view &line);
+  // take the text up to the next tab off buf, the rest if none
+  std::string_view pop_field(std::string_view &buf);
+  // non-negative decimal integer spanning the whole string
+  bool parse_uint(std::string_view s, int &val);
+
 }  // namespace lacam
@@ -0,0 +1,263 @@
+#include "../include/batched_pibt.hpp"
+
+namespace lacam
+{
+
+  BatchedPIBT::BatchedPIBT(const Instance *_ins, DistTableMultiGoal *_D,
+                           const int _K, int seed, Scatter *_scatter,
+                           bool _allow_following, int first_stream)
+      : ins(_ins),
+        N(ins->N),
+        V_size(ins->G->size()),
+        K(_K),
+        D(_D),
+        MTs_calls(),
+        MTs(K),
+        NO_AGENT(N),
+        occupied_now(V_size, NO_AGENT),
+        occupied_next(V_size * K, NO_AGENT),
+        Q_next(N * K, nullptr),
+        C_next(N * K, std::array<Vertex *, 5>()),
+        base_keys(N, std::array<float, 5>()),
+        base_keys_stamp(N, 0),
+        stamp(0),
+        inheritance(),
+        scatter(_scatter),
+        allow_following(_allow_following)
+  {
+    for (auto k = 0; k < K; ++k) MTs_calls.emplace_back(seed, first_stream + k);
+    inheritance.reserve(N);
+    funcPIBT_impl = allow_following ? &BatchedPIBT::funcPIBT<true>
+                                    : &BatchedPIBT::funcPIBT<false>;
+  }
+
+  BatchedPIBT::~BatchedPIBT() {}
+
+  void BatchedPIBT::set_new_configs(const Config &Q_from,
+                                    std::vector<Config> &Q_tos,
+                                    const std::vector<int> &order,
+                                    std::vector<bool> &success)
+  {
+    // base keys of the previous call are stale
+    ++stamp;
+    for (auto k = 0; k < K; ++k) MTs[k] = RNG(MTs_calls[k]());
+
+    // set occupied_now, common to all lanes
+    for (auto i = 0; i < N; ++i) occupied_now[Q_from[i]->id] = i;
+
+    // constraints are shared, check them once and set all lanes
+    const auto &Q_constraints = Q_tos[0];
+    auto ok = true;
+    for (auto i = 0; i < N; ++i) {
+      const auto v = Q_constraints[i];
+      for (auto k = 0; k < K; ++k) Q_next[i * K + k] = v;
+      if (v == nullptr || !ok) continue;
+      // vertex conflict
+      if (occupied_next[v->id * K] != NO_AGENT) {
+        ok = false;
+        continue;
+      }
+      const auto j = occupied_now[v->id];
+      if (allow_following) {
+        // swap conflict
+        if (j != NO_AGENT && j != i && Q_constraints[j] == Q_from[i]) {
+          ok = false;
+          continue;
+        }
+      } else {
+        // following conflict
+        if (j != NO_AGENT && j != i) {
+          ok = false;
+          continue;
+        }
+      }
+      for (auto k = 0; k < K; ++k) occupied_next[v->id * K + k] = i;
+    }
+
+    // rollouts in lockstep
+    success.assign(K, ok);
+    if (ok) {
+      for (auto i : order) {
+        for (auto k = 0; k < K; ++k) {
+          if (success[k] && Q_next[i * K + k] == nullptr &&
+              !(this->*funcPIBT_impl)(k, i, Q_from)) {
+            success[k] = false;
+          }
+        }
+      }
+    }
+
+    // output and cleanup
+    for (auto i = 0; i < N; ++i) {
+      occupied_now[Q_from[i]->id] = NO_AGENT;
+      for (auto k = 0; k < K; ++k) {
+        const auto v = Q_next[i * K + k];
+        Q_tos[k][i] = v;
+        if (v != nullptr) occupied_next[v->id * K + k] = NO_AGENT;
+      }
+    }
+  }
+
+  template <bool ALLOW_FOLLOWING>
+  bool BatchedPIBT::funcPIBT(const int lane, const int i_root,
+                             const Config &Q_from)
+  {
+    // same as PIBT::funcPIBT, reading and writing the lane
+    inheritance.clear();
+    auto i = i_root;
+    auto k = 0;
+    auto num_candidates = 0;
+    auto i_parent = NO_AGENT;  // to set up a new frame, or -1 on resuming
+
+    while (true) {
+      if (i_parent != -1) {
+        num_candidates =
+            set_candidates<ALLOW_FOLLOWING>(lane, i, i_parent, Q_from);
+      }
+      const auto &C = C_next[i * K + lane];
+      auto j_next = NO_AGENT;  // agent inheriting the priority
+      auto aborted = false;
+
+      // main loop
+      for (; k < num_candidates; ++k) {
+        auto u = C[k];
+
+        // avoid vertex conflicts
+        if (occupied_next[u->id * K + lane] != NO_AGENT) continue;
+
+        const auto j = occupied_now[u->id];
+        if (ALLOW_FOLLOWING) {
+          // avoid swap conflicts with constraints
+          if (j != NO_AGENT && Q_next[j * K + lane] == Q_from[i]) continue;
+
+          // reserve next location
+          occupied_next[u->id * K + lane] = i;
+          Q_next[i * K + lane] = u;
+
+          // priority inheritance
+          if (j != NO_AGENT && u != Q_from[i] &&
+              Q_next[j * K + lane] == nullptr) {
+            j_next = j;
+            break;
+          }
+
+          // success to plan next one step
+          return true;
+        } else {
+          // avoid following conflicts
+          if (j != NO_AGENT && j != i) {
+            if (Q_next[j * K + lane] == nullptr) {
+              // preemptively reserve current location
+              if (occupied_next[Q_from[i]->id * K + lane] != NO_AGENT) {
+                info(1, 1, "agent-", i,
+                     " trying to preemptively reserve vertex-", u->id,
+                     ", but it is already reserved by agent-",
+                     occupied_next[Q_from[i]->id * K + lane]);
+                aborted = true;
+                break;
+              }
+              occupied_next[Q_from[i]->id * K + lane] = i;
+              Q_next[i * K + lane] = Q_from[i];
+
+              // priority inheritance
+              j_next = j;
+              break;
+            }
+            continue;
+          }
+          // success
+          occupied_next[u->id * K + lane] = i;
+          Q_next[i * K + lane] = u;
+          return true;
+        }
+      }
+
+      if (j_next != NO_AGENT) {
+        inheritance.push_back({i, k, num_candidates});
+        i_parent = ALLOW_FOLLOWING ? NO_AGENT : i;
+        i = j_next;
+        k = 0;
+        continue;
+      }
+
+      if (!aborted) {
+        // failed to secure node, remain at current location
+        occupied_next[Q_from[i]->id * K + lane] = i;
+        Q_next[i * K + lane] = Q_from[i];
+      }
+
+      // back to the caller
+      if (inheritance.empty()) break;
+      i = inheritance.back().i;
+      k = inheritance.back().k + 1;
+      num_candidates = inheritance.back().num_candidates;
+      i_parent = -1;
+      inheritance.pop_back();
+      if (!ALLOW_FOLLOWING) {
+        // revert if priority inheritance failed
+        occupied_next[Q_from[i]->id * K + lane] = NO_AGENT;
+        Q_next[i * K + lane] = nullptr;
+      }
+    }
+
+    return false;
+  }
+
+  template <bool ALLOW_FOLLOWING>
+  int BatchedPIBT::set_candidates(const int lane, const int i,
+                                  const int i_caller, const Config &Q_from)
+  {
+    const auto &cands = Q_from[i]->candidates;  // neighbors, then itself
+    const auto K_i = (int)cands.size() - 1;
+    const auto &base = get_base_keys(i, Q_from);
+    auto &C = C_next[i * K + lane];
+
+    auto num_candidates = K_i;
+    if (ALLOW_FOLLOWING || i_caller == NO_AGENT) num_candidates++;
+
+    // sort C_next, with tie-breakers drawn at once
+    float rands[5];
+    MTs[lane].get_floats(rands, num_candidates);
+    auto keys = std::array<std::pair<float, Vertex *>, 5>();
+    for (auto k = 0; k < num_candidates; ++k) {
+      keys[k] = {base[k] + rands[k], cands[k]};
+    }
+    // insertion sort, as std::sort does for such few elements
+    for (auto k = 1; k < num_candidates; ++k) {
+      const auto key = keys[k];
+      auto l = k;
+      for (; l > 0 && key.first < keys[l - 1].first; --l) keys[l] = keys[l - 1];
+      keys[l] = key;
+    }
+    for (auto k = 0; k < num_candidates; ++k) C[k] = keys[k].second;
+
+    return num_candidates;
+  }
+
+  const std::array<float, 5> &BatchedPIBT::get_base_keys(const int i,
+                                                         const Config &Q_from)
+  {
+    auto &keys = base_keys[i];
+    if (base_keys_stamp[i] == stamp) return keys;
+    base_keys_stamp[i] = stamp;
+
+    const auto &cands = Q_from[i]->candidates;
+    const auto g = Q_from.goal_indices[i];
+    for (size_t k = 0; k < cands.size(); ++k) keys[k] = D->get(i, g, cands[k]);
+
+    // exploit scatter data, the prioritized vertex comes first
+    if (scatter != nullptr) {
+      const auto &data_for_this_goal = scatter->scatter_data_labeled[i][g];
+      auto itr_s = data_for_this_goal.find(Q_from[i]->id);
+      if (itr_s != data_for_this_goal.end()) {
+        for (size_t k = 0; k < cands.size(); ++k) {
+          if (cands[k] == itr_s->second) {
+            keys[k] = -std::numeric_limits<float>::infinity();
+          }
+        }
+      }
+    }
+    return keys;
+  }
+
+}  // namespace lacam
@@ -1,55 +1,578 @@
 #include "../include/dist_table.hpp"
 
+#include "../include/thread_pool.hpp"
+
+#include <filesystem>
+#include <unistd.h>
+
 namespace lacam
 {
 
+  bool DistTableMultiGoal::FLG_LAZY = false;
+  std::string DistTableMultiGoal::CACHE_DIR = "";
+  bool DistTableMultiGoal::FLG_COMPRESS = false;
+  int DistTableMultiGoal::NUM_LANDMARKS = 0;
+  int DistTableMultiGoal::LANDMARK_RADIUS = 20;
+
+  // header of cache files, followed by |V| distances
+  struct DistCacheHeader {
+    char magic[8];
+    uint64_t map_hash;
+    uint32_t num_vertices;
+    uint32_t goal;
+    uint32_t elem_size;
+    uint32_t reserved;
+  };
+  static constexpr char DIST_CACHE_MAGIC[8] = {'L', 'A', 'C', 'A',
+                                               'M', 'D', 'T', '1'};
+
+  // FNV-1a over the grid layout, stable across runs
+  static uint64_t get_graph_hash(const Graph *G)
+  {
+    auto h = (uint64_t)14695981039346656037ull;
+    auto mix = [&](uint64_t x) {
+      for (auto k = 0; k < 8; ++k) {
+        h ^= (x >> (8 * k)) & 0xff;
+        h *= 1099511628211ull;
+      }
+    };
+    mix(G->width);
+    mix(G->height);
+    for (auto v : G->V) mix(v->index);
+    return h;
+  }
+
+  // BFS from up to 64 sources at once, bit b of a per-vertex word stands for
+  // the b-th source; visit(b, v, d) is called once per source and vertex
+  template <typename F>
+  static void batched_bfs(const std::vector<int> &sources, const Graph *G,
+                          F &&visit)
+  {
+    const auto K = G->V.size();
+    const auto &adj_offset = G->adj_offset;
+    const auto &adj = G->adj;  // self-loops do not change the result
+    auto visited = std::vector<uint64_t>(K, 0);
+    auto frontier = std::vector<uint64_t>(K, 0);
+    auto next = std::vector<uint64_t>(K, 0);
+    auto frontier_list = std::vector<int>();
+    auto next_list = std::vector<int>();
+
+    for (size_t b = 0; b < sources.size(); ++b) {
+      const auto g = sources[b];
+      visit(b, g, 0);
+      if (frontier[g] == 0) frontier_list.push_back(g);
+      frontier[g] |= (uint64_t)1 << b;
+      visited[g] |= (uint64_t)1 << b;
+    }
+
+    // all sources advance one level per sweep
+    for (auto d = 1; !frontier_list.empty(); ++d) {
+      for (auto v : frontier_list) {
+        for (auto k = adj_offset[v]; k < adj_offset[v + 1]; ++k) {
+          const auto u = adj[k];
+          const auto bits = frontier[v] & ~visited[u];
+          if (bits == 0) continue;
+          if (next[u] == 0) next_list.push_back(u);
+          next[u] |= bits;
+        }
+      }
+      for (auto v : frontier_list) frontier[v] = 0;
+      for (auto u : next_list) {
+        visited[u] |= next[u];
+        for (auto bits = next[u]; bits != 0; bits &= bits - 1) {
+          visit(__builtin_ctzll(bits), u, d);
+        }
+        frontier[u] = next[u];
+        next[u] = 0;
+      }
+      std::swap(frontier_list, next_list);
+      next_list.clear();
+    }
+  }
+
   DistTableMultiGoal::DistTableMultiGoal(const Instance *ins)
-      : K(ins->G->V.size())
+      : K(ins->G->V.size()),
+        narrow(K <= UINT16_MAX),
+        compressed(FLG_COMPRESS && narrow && NUM_LANDMARKS <= 0),
+        num_landmarks(std::max(0, std::min(NUM_LANDMARKS, K))),
+        map_hash(0),
+        row_offset(ins->N),
+        row_count(ins->N),
+        row_ids(),
+        rows(),
+        slab16(),
+        slab32(),
+        anchor_mask(),
+        anchor_offset(),
+        landmarks(),
+        landmark_dist(),
+        G(ins->G),
+        setup_ms(0)
   {
+    const auto deadline = Deadline();
     setup(ins);
+    setup_ms = deadline.elapsed_ms();
   }
 
   void DistTableMultiGoal::setup(const Instance *ins)
   {
-    // initialize all values to K
-    for (size_t i = 0; i < ins->N; i++) {
-      table.push_back(std::vector<std::vector<int>>(
-          ins->goal_sequences[i].size(), std::vector<int>(K, K)));
-    }
-
-    auto bfs = [&](const int i, const int j) {
-      const auto g_ij = ins->goal_sequences[i][j];
-      auto Q = std::queue<Vertex *>({g_ij});
-      table[i][j][g_ij->id] = 0;
-      while (!Q.empty()) {
-        const auto n = Q.front();
-        Q.pop();
-        const int d_n = table[i][j][n->id];
-        for (auto &m : n->neighbor) {
-          const int d_m = table[i][j][m->id];
-          if (d_n + 1 >= d_m) continue;
-          table[i][j][m->id] = d_n + 1;
-          Q.push(m);
+    // one row per distinct goal vertex
+    auto goal_to_row = std::vector<int>(K, -1);
+    auto goals = std::vector<Vertex *>();
+    for (size_t i = 0; i < ins->N; ++i) {
+      row_offset[i] = row_ids.size();
+      row_count[i] = ins->goal_sequences[i].size();
+      for (auto g : ins->goal_sequences[i]) {
+        if (goal_to_row[g->id] == -1) {
+          goal_to_row[g->id] = goals.size();
+          goals.push_back(g);
         }
+        row_ids.push_back(goal_to_row[g->id]);
+      }
+    }
+    rows = std::vector<Row>(goals.size());
+    for (size_t r = 0; r < goals.size(); ++r) rows[r].goal = goals[r];
+
+    if (compressed) {
+      // anchors are shared by all rows
+      const auto num_blocks = (K + 63) / 64;
+      anchor_mask.assign(num_blocks, 0);
+      anchor_offset.assign(num_blocks + 1, 0);
+      for (auto v : ins->G->V) {
+        const auto &nbr = v->neighbor;
+        if (v->id % 64 == 0 ||
+            std::find(nbr.begin(), nbr.end(), ins->G->V[v->id - 1]) ==
+                nbr.end()) {
+          anchor_mask[v->id / 64] |= (uint64_t)1 << (v->id % 64);
+        }
+      }
+      for (auto b = 0; b < num_blocks; ++b) {
+        anchor_offset[b + 1] =
+            anchor_offset[b] + __builtin_popcountll(anchor_mask[b]);
+      }
+    } else if (num_landmarks == 0) {
+      // contiguous slab, left uninitialized until a row is first queried
+      const auto slab_size = rows.size() * K;
+      if (narrow) {
+        slab16.reset(new std::atomic<uint16_t>[slab_size]);
+      } else {
+        slab32.reset(new std::atomic<int>[slab_size]);
+      }
+    }
+
+    if (!CACHE_DIR.empty()) {
+      map_hash = get_graph_hash(ins->G);
+      std::error_code ec;
+      std::filesystem::create_directories(CACHE_DIR, ec);
+      for (auto &row : rows) load_row(row);
+    }
+    if (num_landmarks > 0) {
+      setup_landmarks();
+      return;
+    }
+    if (FLG_LAZY) return;
+
+    // batch nearby goals together, in Morton order, so that their
+    // wavefronts overlap and share sweeps
+    auto order = std::vector<int>();
+    for (size_t r = 0; r < rows.size(); ++r) {
+      if (!rows[r].complete) order.push_back(r);
+    }
+    auto morton = [&](const int r) {
+      uint64_t key = 0;
+      const uint32_t x = rows[r].goal->x;
+      const uint32_t y = rows[r].goal->y;
+      for (auto k = 0; k < 32; ++k) {
+        key |= (uint64_t)((x >> k) & 1) << (2 * k);
+        key |= (uint64_t)((y >> k) & 1) << (2 * k + 1);
       }
+      return key;
     };
+    std::sort(order.begin(), order.end(),
+              [&](int a, int b) { return morton(a) < morton(b); });
 
-    auto pool = std::vector<std::future<void>>();
-    for (size_t i = 0; i < ins->N; ++i) {
-      for (size_t j = 0; j < ins->goal_sequences[i].size(); ++j) {
-        pool.emplace_back(std::async(std::launch::async, bfs, i, j));
+    // batches of BATCH_SIZE rows, run on a pool bounded by the cores
+    auto batches = std::vector<std::vector<int>>();
+    for (auto r : order) {
+      if (batches.empty() || batches.back().size() == BATCH_SIZE)
+        batches.emplace_back();
+      batches.back().push_back(r);
+    }
+    const auto num_threads =
+        std::min((size_t)std::max(1u, std::thread::hardware_concurrency()),
+                 batches.size());
+    if (num_threads <= 1) {
+      for (auto &batch : batches) expand_batch(batch);
+    } else {
+      auto pool = ThreadPool(num_threads - 1, false);  // with the caller
+      pool.run(batches.size(), [&](int k) { expand_batch(batches[k]); });
+    }
+  }
+
+  void DistTableMultiGoal::expand_batch(const std::vector<int> &batch) const
+  {
+    auto sources = std::vector<int>();
+    for (auto r : batch) sources.push_back(rows[r].goal->id);
+    const auto relaxed = std::memory_order_relaxed;
+
+    // compressed rows are encoded from a temporary buffer
+    auto buf = std::vector<uint16_t>();
+    if (compressed) {
+      buf.assign(batch.size() * K, K);
+      batched_bfs(sources, G, [&](int b, int v, int d) {
+        buf[(size_t)b * K + v] = d;
+      });
+    } else {
+      for (auto r : batch) {
+        const size_t base = (size_t)r * K;
+        for (auto k = 0; k < K; ++k) store(base + k, K, relaxed);
       }
+      batched_bfs(sources, G, [&](int b, int v, int d) {
+        store((size_t)batch[b] * K + v, d, relaxed);
+      });
+    }
+
+    auto completed = std::vector<int>();
+    for (size_t b = 0; b < batch.size(); ++b) {
+      auto &row = rows[batch[b]];
+      std::lock_guard<std::mutex> lock(row.m);
+      if (row.complete.load(relaxed)) continue;  // by another thread
+      if (compressed) encode(row, buf.data() + b * K);
+      row.initialized.store(true, std::memory_order_release);
+      row.complete.store(true, std::memory_order_release);
+      completed.push_back(batch[b]);
+    }
+    // rows are immutable once complete, hence written without the lock
+    if (!CACHE_DIR.empty()) {
+      for (auto r : completed) save_row(r);
     }
   }
 
+  void DistTableMultiGoal::encode(Row &row, const uint16_t *dist) const
+  {
+    row.anchors.resize(anchor_offset.back());
+    row.signs.assign(anchor_mask.size(), 0);
+    auto a = 0;
+    for (auto v = 0; v < K; ++v) {
+      if ((anchor_mask[v / 64] >> (v % 64)) & 1) {
+        row.anchors[a++] = dist[v];
+      } else if (dist[v] > dist[v - 1]) {
+        row.signs[v / 64] |= (uint64_t)1 << (v % 64);
+      }
+    }
+  }
+
+  int DistTableMultiGoal::decode(const Row &row, const int v_id) const
+  {
+    const auto b = v_id / 64;
+    const auto j = v_id % 64;
+    // the nearest anchor at or before v_id within the block
+    const auto upto_j = ~(uint64_t)0 >> (63 - j);
+    const auto m = anchor_mask[b] & upto_j;
+    const auto pos = 63 - __builtin_clzll(m);
+    const int d = row.anchors[anchor_offset[b] + __builtin_popcountll(m) - 1];
+    if (d == K) return K;  // unreachable, so is its whole chain
+    const auto upto_pos = ~(uint64_t)0 >> (63 - pos);
+    const auto ups = __builtin_popcountll(row.signs[b] & upto_j & ~upto_pos);
+    return d + 2 * ups - (j - pos);
+  }
+
+  void DistTableMultiGoal::setup_landmarks()
+  {
+    // farthest-point selection, starting from the vertex farthest from the
+    // first goal; landmarks stay in its component, elsewhere bounds are zero
+    landmark_dist.assign((size_t)K * num_landmarks, K);
+    auto dist = std::vector<int>(K, K);
+    auto min_dist = std::vector<int>(K, K);
+    auto bfs = [&](const int s) {
+      std::fill(dist.begin(), dist.end(), K);
+      batched_bfs({s}, G,
+                  [&](int, int v, int d) { dist[v] = d; });
+    };
+    auto farthest = [&](const std::vector<int> &arr) {
+      auto v_max = -1;
+      for (auto v = 0; v < K; ++v) {
+        if (arr[v] == K) continue;  // other components
+        if (v_max == -1 || arr[v] > arr[v_max]) v_max = v;
+      }
+      return v_max;
+    };
+    bfs(rows.empty() ? 0 : rows[0].goal->id);
+    auto next = farthest(dist);
+    for (auto l = 0; l < num_landmarks; ++l) {
+      landmarks.push_back(next);
+      bfs(next);
+      for (auto v = 0; v < K; ++v) {
+        landmark_dist[(size_t)v * num_landmarks + l] = dist[v];
+        min_dist[v] = std::min(min_dist[v], dist[v]);
+      }
+      next = farthest(min_dist);
+    }
+  }
+
+  int DistTableMultiGoal::get_lower_bound(const int goal_id,
+                                          const int v_id) const
+  {
+    auto lb = 0;
+    const auto d_v = &landmark_dist[(size_t)v_id * num_landmarks];
+    const auto d_g = &landmark_dist[(size_t)goal_id * num_landmarks];
+    for (auto l = 0; l < num_landmarks; ++l) {
+      if (d_v[l] == K && d_g[l] == K) continue;
+      if (d_v[l] == K || d_g[l] == K) return K;  // different components
+      lb = std::max(lb, std::abs(d_v[l] - d_g[l]));
+    }
+    return lb;
+  }
+
+  int DistTableMultiGoal::get_with_landmarks(const int row_id,
+                                             const int v_id) const
+  {
+    const auto &row = rows[row_id];
+    if (!row.complete.load(std::memory_order_acquire)) expand_ball(row_id);
+
+    // near the goal, exact
+    const auto d = find_in_ball(row, v_id);
+    if (d >= 0) return d;
+    return std::max(get_lower_bound(row.goal->id, v_id), LANDMARK_RADIUS + 1);
+  }
+
+  void DistTableMultiGoal::expand_ball(const int row_id) const
+  {
+    auto &row = rows[row_id];
+    std::lock_guard<std::mutex> lock(row.m);
+    if (row.complete.load(std::memory_order_relaxed)) return;
+
+    // BFS up to the radius, marks are reset afterwards, O(ball) per row
+    thread_local auto dist = std::vector<int>();
+    dist.resize(K, -1);
+    auto queue = std::vector<int>{row.goal->id};
+    dist[row.goal->id] = 0;
+    for (size_t head = 0; head < queue.size(); ++head) {
+      const auto n = queue[head];
+      if (dist[n] >= LANDMARK_RADIUS) continue;
+      for (auto a = G->adj_offset[n]; a < G->adj_offset[n + 1] - 1; ++a) {
+        const auto m = G->adj[a];
+        if (dist[m] != -1) continue;
+        dist[m] = dist[n] + 1;
+        queue.push_back(m);
+      }
+    }
+
+    size_t capacity = 1;
+    while (capacity < queue.size() * 2) capacity *= 2;
+    if (capacity * sizeof(uint64_t) >= K * sizeof(uint16_t) &&
+        LANDMARK_RADIUS < UINT16_MAX) {
+      row.ball_dense.assign(K, UINT16_MAX);
+      for (auto v : queue) {
+        row.ball_dense[v] = dist[v];
+        dist[v] = -1;
+      }
+      row.initialized.store(true, std::memory_order_relaxed);
+      row.complete.store(true, std::memory_order_release);
+      return;
+    }
+    row.ball.assign(capacity, UINT64_MAX);
+    for (auto v : queue) {
+      auto slot = ((uint32_t)v * 0x9e3779b1u) & (capacity - 1);
+      while (row.ball[slot] != UINT64_MAX) slot = (slot + 1) & (capacity - 1);
+      row.ball[slot] = ((uint64_t)v << 32) | (uint32_t)dist[v];
+      dist[v] = -1;
+    }
+    row.initialized.store(true, std::memory_order_relaxed);
+    row.complete.store(true, std::memory_order_release);
+  }
+
+  int DistTableMultiGoal::find_in_ball(const Row &row, const int v_id) const
+  {
+    if (!row.ball_dense.empty()) {
+      const auto d = row.ball_dense[v_id];
+      return d == UINT16_MAX ? -1 : d;
+    }
+    const auto mask = row.ball.size() - 1;
+    auto slot = ((uint32_t)v_id * 0x9e3779b1u) & mask;
+    while (row.ball[slot] != UINT64_MAX) {
+      if ((row.ball[slot] >> 32) == (uint64_t)v_id) {
+        return (int)(uint32_t)row.ball[slot];
+      }
+      slot = (slot + 1) & mask;
+    }
+    return -1;
+  }
+
+  void DistTableMultiGoal::expand(const int row_id, const int v_id) const
+  {
+    auto &row = rows[row_id];
+    std::unique_lock<std::mutex> lock(row.m);
+    if (row.complete.load(std::memory_order_relaxed)) return;
+
+    const size_t base = (size_t)row_id * K;
+    const auto relaxed = std::memory_order_relaxed;
+
+    // first query, initialize
+    if (!row.initialized.load(relaxed)) {
+      for (auto k = 0; k < K; ++k) store(base + k, K, relaxed);
+      store(base + row.goal->id, 0, relaxed);
+      row.frontier.push_back(row.goal->id);
+      row.initialized.store(true, std::memory_order_release);
+    }
+
+    // distances are final once assigned, since all edges have unit cost;
+    // rows to be cached are completed at once
+    const auto until_end = !CACHE_DIR.empty();
+    while ((until_end || load(base + v_id, relaxed) == K) &&
+           row.frontier_head < row.frontier.size()) {
+      const auto n = row.frontier[row.frontier_head];
+      const int d_n = load(base + n, relaxed);
+      ++row.frontier_head;
+      // neighbors in the CSR layout, without n itself at the end
+      for (auto a = G->adj_offset[n]; a < G->adj_offset[n + 1] - 1; ++a) {
+        const auto m = G->adj[a];
+        if (load(base + m, relaxed) != K) continue;
+        store(base + m, d_n + 1, std::memory_order_release);
+        row.frontier.push_back(m);
+      }
+    }
+
+    if (row.frontier_head == row.frontier.size()) {
+      std::vector<uint32_t>().swap(row.frontier);
+      row.frontier_head = 0;
+      row.complete.store(true, std::memory_order_release);
+      // rows are immutable once complete, hence written without the lock
+      lock.unlock();
+      if (!CACHE_DIR.empty()) save_row(row_id);
+    } else if (row.frontier_head * 2 >= row.frontier.size()) {
+      // keep only the wavefront, the consumed part is dropped
+      row.frontier.erase(row.frontier.begin(),
+                         row.frontier.begin() + row.frontier_head);
+      row.frontier.shrink_to_fit();
+      row.frontier_head = 0;
+    }
+  }
+
+  std::string DistTableMultiGoal::get_cache_filename(const Row &row) const
+  {
+    std::stringstream ss;
+    ss << CACHE_DIR << "/" << std::hex << map_hash << std::dec << "-"
+       << row.goal->id << ".dist";
+    return ss.str();
+  }
+
+  bool DistTableMultiGoal::load_row(Row &row)
+  {
+    const auto elem_size = narrow ? sizeof(uint16_t) : sizeof(int);
+    auto file = std::make_unique<MappedFile>(get_cache_filename(row));
+    if (file->data == nullptr ||
+        file->size != sizeof(DistCacheHeader) + elem_size * K)
+      return false;
+    DistCacheHeader header;
+    std::memcpy(&header, file->data, sizeof(header));
+    if (std::memcmp(header.magic, DIST_CACHE_MAGIC, 8) != 0 ||
+        header.map_hash != map_hash || header.num_vertices != (uint32_t)K ||
+        header.goal != (uint32_t)row.goal->id || header.elem_size != elem_size)
+      return false;
+    row.cached = file->data + sizeof(DistCacheHeader);
+    row.cache = std::move(file);
+    row.initialized = true;
+    row.complete = true;
+    return true;
+  }
+
+  void DistTableMultiGoal::save_row(const int row_id) const
+  {
+    const auto &row = rows[row_id];
+    const auto elem_size = narrow ? sizeof(uint16_t) : sizeof(int);
+    auto header = DistCacheHeader();
+    std::memcpy(header.magic, DIST_CACHE_MAGIC, 8);
+    header.map_hash = map_hash;
+    header.num_vertices = K;
+    header.goal = row.goal->id;
+    header.elem_size = elem_size;
+    header.reserved = 0;
+
+    auto buf = std::vector<char>(sizeof(header) + elem_size * K);
+    std::memcpy(buf.data(), &header, sizeof(header));
+    auto body = buf.data() + sizeof(header);
+    const size_t base = (size_t)row_id * K;
+    for (auto k = 0; k < K; ++k) {
+      const auto d = compressed ? decode(row, k)
+                                : load(base + k, std::memory_order_relaxed);
+      if (narrow) {
+        const auto d16 = (uint16_t)d;
+        std::memcpy(body + k * elem_size, &d16, elem_size);
+      } else {
+        std::memcpy(body + k * elem_size, &d, elem_size);
+      }
+    }
+
+    // write to a temporary file then rename, readers never see partial rows
+    const auto filename = get_cache_filename(row);
+    const auto tmp_filename = filename + "." + std::to_string(getpid());
+    std::ofstream out(tmp_filename, std::ios::binary);
+    out.write(buf.data(), buf.size());
+    out.close();
+    if (!out || std::rename(tmp_filename.c_str(), filename.c_str()) != 0) {
+      std::remove(tmp_filename.c_str());
+    }
+  }
+
+  size_t DistTableMultiGoal::num_cached_rows() const
+  {
+    size_t cnt = 0;
+    for (auto &row : rows) cnt += (row.cached != nullptr);
+    return cnt;
+  }
+
+  size_t DistTableMultiGoal::bytes() const
+  {
+    size_t cnt = landmark_dist.capacity() * sizeof(int);
+    for (auto &row : rows) {
+      if (row.cached != nullptr) continue;  // mapped from the cache
+      if (!row.complete) {
+        std::lock_guard<std::mutex> lock(row.m);
+        cnt += row.frontier.capacity() * sizeof(uint32_t);
+      }
+      if (num_landmarks > 0) {
+        if (row.complete) {
+          cnt += row.ball.capacity() * sizeof(uint64_t) +
+                 row.ball_dense.capacity() * sizeof(uint16_t);
+        }
+      } else if (compressed) {
+        cnt += row.anchors.capacity() * sizeof(uint16_t) +
+               row.signs.capacity() * sizeof(uint64_t);
+      } else if (row.initialized) {
+        cnt += (size_t)K * (narrow ? sizeof(uint16_t) : sizeof(int));
+      }
+    }
+    return cnt;
+  }
+
   int DistTableMultiGoal::get(const int i, const int goal_index,
                               const int v_id) const
   {
     // goal_index can be past the end to signify we've already reached the last
     // goal, but when we want to use the index we need to cap it at the last
     // goal
-    auto idx = std::min(goal_index, (int)(table[i].size() - 1));
-    return table[i][idx][v_id];
+    auto idx = std::min(goal_index, row_count[i] - 1);
+    const auto row_id = row_ids[row_offset[i] + idx];
+    const auto &row = rows[row_id];
+    if (row.cached != nullptr) {
+      return narrow ? static_cast<const uint16_t *>(row.cached)[v_id]
+                    : static_cast<const int *>(row.cached)[v_id];
+    }
+    if (num_landmarks > 0) return get_with_landmarks(row_id, v_id);
+    if (compressed) {
+      if (!row.complete.load(std::memory_order_acquire)) {
+        expand_batch({row_id});
+      }
+      return decode(row, v_id);
+    }
+    const auto k = (size_t)row_id * K + v_id;
+    if (row.initialized.load(std::memory_order_acquire)) {
+      const auto d = load(k, std::memory_order_acquire);
+      if (d != K || row.complete.load(std::memory_order_acquire)) return d;
+    }
+    expand(row_id, v_id);
+    return load(k, std::memory_order_relaxed);
   }
 
 }  // namespace lacam
@@ -0,0 +1,48 @@
+#include "../include/explored_table.hpp"
+
+namespace lacam
+{
+
+  ExploredTable::ExploredTable(size_t initial_capacity)
+      : slots(), num_entries(0)
+  {
+    size_t capacity = 1;
+    while (capacity < initial_capacity) capacity <<= 1;
+    slots.assign(capacity, Slot{0, nullptr});
+  }
+
+  HNode *ExploredTable::find(const PackedConfig &C) const
+  {
+    const auto mask = slots.size() - 1;
+    for (auto k = C.hash & mask;; k = (k + 1) & mask) {
+      const auto &slot = slots[k];
+      if (slot.node == nullptr) return nullptr;
+      if (slot.hash == C.hash && slot.node->C == C) return slot.node;
+    }
+  }
+
+  void ExploredTable::insert(HNode *H)
+  {
+    // keep the load factor at most 1/2
+    if ((num_entries + 1) * 2 > slots.size()) grow();
+    const auto mask = slots.size() - 1;
+    auto k = H->C.hash & mask;
+    while (slots[k].node != nullptr) k = (k + 1) & mask;
+    slots[k] = Slot{H->C.hash, H};
+    ++num_entries;
+  }
+
+  void ExploredTable::grow()
+  {
+    auto old_slots = std::vector<Slot>(slots.size() * 2, Slot{0, nullptr});
+    std::swap(slots, old_slots);
+    const auto mask = slots.size() - 1;
+    for (auto &slot : old_slots) {
+      if (slot.node == nullptr) continue;
+      auto k = slot.hash & mask;
+      while (slots[k].node != nullptr) k = (k + 1) & mask;
+      slots[k] = slot;
+    }
+  }
+
+}  // namespace lacam
@@ -4,7 +4,7 @@ namespace lacam
 {
 
   Vertex::Vertex(int _id, int _index, int _x, int _y)
-      : id(_id), index(_index), x(_x), y(_y), neighbor()
+      : id(_id), index(_index), x(_x), y(_y), neighbor(), candidates()
   {
   }
 
@@ -13,89 +13,155 @@ namespace lacam
       return "(" + std::to_string(x) + "," + std::to_string(y) + ")";
   }
 
-  Graph::Graph() : V(Vertices()), width(0), height(0) {}
+  bool Graph::FLG_HILBERT_ORDER = false;
+  bool Graph::FLG_CSR_LAYOUT = true;
 
-  Graph::~Graph()
+  // position of (x, y) along the Hilbert curve filling an n x n grid,
+  // n is a power of two
+  static uint64_t get_hilbert_key(const int n, int x, int y)
   {
-    for (auto &v : V)
-      if (v != nullptr) delete v;
-    V.clear();
+    uint64_t d = 0;
+    for (auto s = n / 2; s > 0; s /= 2) {
+      const auto rx = (x & s) > 0;
+      const auto ry = (y & s) > 0;
+      d += (uint64_t)s * s * ((3 * rx) ^ ry);
+      // rotate
+      if (!ry) {
+        if (rx) {
+          x = s - 1 - x;
+          y = s - 1 - y;
+        }
+        std::swap(x, y);
+      }
+    }
+    return d;
   }
 
-  // to load graph
-  static const std::regex r_height = std::regex(R"(height\s(\d+))");
-  static const std::regex r_width = std::regex(R"(width\s(\d+))");
-  static const std::regex r_map = std::regex(R"(map)");
+  Graph::Graph()
+      : V(Vertices()),
+        width(0),
+        height(0),
+        vertices(),
+        adj_offset(1, 0),
+        adj(),
+        adj_ptr()
+  {
+  }
+
+  Graph::~Graph() {}
 
-  Graph::Graph(const std::string &filename) : V(Vertices()), width(0), height(0)
+  Graph::Graph(const std::string &filename)
+      : V(Vertices()),
+        width(0),
+        height(0),
+        vertices(),
+        adj_offset(1, 0),
+        adj(),
+        adj_ptr()
   {
-    std::ifstream file(filename);
-    if (!file) {
+    const auto file = MappedFile(filename);
+    if (file.data == nullptr) {
       std::cout << "file " << filename << " is not found." << std::endl;
       return;
     }
-    std::string line;
-    std::smatch results;
-
-    // read fundamental graph parameters
-    while (getline(file, line)) {
-      // for CRLF coding
-      if (*(line.end() - 1) == 0x0d) line.pop_back();
+    auto buf = std::string_view(file.data, file.size);
+    std::string_view line;
 
-      if (std::regex_match(line, results, r_height)) {
-        height = std::stoi(results[1].str());
+    // read fundamental graph parameters, "height H", "width W", then "map"
+    auto parse_param = [&](const std::string_view key, int &val) {
+      if (line.size() > key.size() + 1 && line.substr(0, key.size()) == key &&
+          std::isspace((unsigned char)line[key.size()])) {
+        parse_uint(line.substr(key.size() + 1), val);
       }
-      if (std::regex_match(line, results, r_width)) {
-        width = std::stoi(results[1].str());
-      }
-      if (std::regex_match(line, results, r_map)) break;
+    };
+    while (pop_line(buf, line)) {
+      parse_param("height", height);
+      parse_param("width", width);
+      if (line == "map") break;
     }
 
     U = Vertices(width * height, nullptr);
 
-    // create vertices
-    int y = 0;
-    while (getline(file, line)) {
-      // for CRLF coding
-      if (*(line.end() - 1) == 0x0d) line.pop_back();
+    // read the grid first, vertex records are allocated at once;
+    // short lines are padded with obstacles
+    auto lines = std::vector<std::string>();
+    while ((int)lines.size() < height && pop_line(buf, line)) {
+      lines.emplace_back(line.substr(0, width));
+      lines.back().resize(width, '@');
+    }
+    auto num_vertices = 0;
+    for (auto &l : lines) {
+      num_vertices += width - std::count(l.begin(), l.end(), 'T') -
+                      std::count(l.begin(), l.end(), '@');
+    }
+
+    // vertex order, index is kept for grid I/O
+    auto indexes = std::vector<int>();
+    indexes.reserve(num_vertices);
+    for (int y = 0; y < (int)lines.size(); ++y) {
       for (int x = 0; x < width; ++x) {
-        char s = line[x];
+        char s = lines[y][x];
         if (s == 'T' or s == '@') continue;  // object
-        auto index = width * y + x;
-        auto v = new Vertex(V.size(), index, x, y);
-        V.push_back(v);
-        U[index] = v;
+        indexes.push_back(width * y + x);
+      }
+    }
+    if (FLG_HILBERT_ORDER) {
+      auto n = 1;
+      while (n < width || n < height) n *= 2;
+      auto keys = std::vector<uint64_t>(width * height);
+      for (auto k : indexes) keys[k] = get_hilbert_key(n, k % width, k / width);
+      std::sort(indexes.begin(), indexes.end(),
+                [&](int a, int b) { return keys[a] < keys[b]; });
+    }
+
+    // create vertices
+    if (FLG_CSR_LAYOUT) vertices.reserve(num_vertices);
+    for (auto index : indexes) {
+      const int id = V.size();
+      const auto x = index % width;
+      const auto y = index / width;
+      if (FLG_CSR_LAYOUT) {
+        vertices.emplace_back(id, index, x, y);
+        V.push_back(&vertices.back());
+      } else {
+        scattered_vertices.emplace_back(new Vertex(id, index, x, y));
+        V.push_back(scattered_vertices.back().get());
       }
-      ++y;
+      U[index] = V.back();
     }
-    file.close();
 
-    // create edges
-    for (int y = 0; y < height; ++y) {
-      for (int x = 0; x < width; ++x) {
-        auto v = U[width * y + x];
-        if (v == nullptr) continue;
-        // left
-        if (x > 0) {
-          auto u = U[width * y + (x - 1)];
-          if (u != nullptr) v->neighbor.push_back(u);
-        }
-        // right
-        if (x < width - 1) {
-          auto u = U[width * y + (x + 1)];
-          if (u != nullptr) v->neighbor.push_back(u);
-        }
-        // up
-        if (y < height - 1) {
-          auto u = U[width * (y + 1) + x];
-          if (u != nullptr) v->neighbor.push_back(u);
-        }
-        // down
-        if (y > 0) {
-          auto u = U[width * (y - 1) + x];
-          if (u != nullptr) v->neighbor.push_back(u);
+    // create edges: left, right, up, down, then the vertex itself
+    auto add_edge = [&](const int x, const int y) {
+      auto u = U[width * y + x];
+      if (u != nullptr) adj.push_back(u->id);
+    };
+    for (auto v : V) {
+      const auto x = v->x;
+      const auto y = v->y;
+      if (x > 0) add_edge(x - 1, y);
+      if (x < width - 1) add_edge(x + 1, y);
+      if (y < height - 1) add_edge(x, y + 1);
+      if (y > 0) add_edge(x, y - 1);
+      adj.push_back(v->id);
+      adj_offset.push_back(adj.size());
+    }
+    if (FLG_CSR_LAYOUT) {
+      adj_ptr.reserve(adj.size());
+      for (auto k : adj) adj_ptr.push_back(V[k]);
+    }
+    for (auto v : V) {
+      const auto a = adj_offset[v->id];
+      const auto degree = adj_offset[v->id + 1] - a;
+      auto first = adj_ptr.data() + a;
+      if (!FLG_CSR_LAYOUT) {
+        scattered_adj.emplace_back(new Vertex *[degree]);
+        for (auto k = 0; k < degree; ++k) {
+          scattered_adj.back()[k] = V[adj[a + k]];
         }
+        first = scattered_adj.back().get();
       }
+      v->neighbor = VertexSpan(first, first + degree - 1);
+      v->candidates = VertexSpan(first, first + degree);
     }
   }
 
@@ -119,21 +185,49 @@ namespace lacam
     return false;
   }
 
-  uint ConfigHasher::operator()(const Config &C) const
+  bool enough_goals_reached(const PackedConfig &C, int threshold)
+  {
+    int count = 0;
+    for (size_t i = 0; i < C.size(); ++i) {
+      count += C.goal_index(i);
+      if (count >= threshold) return true;
+    }
+    return false;
+  }
+
+  void PackedConfig::pack(const Config &C)
   {
-    uint location_hash = C.size();
-    for (auto &v : C) {
-      location_hash ^=
-          v->id + 0x9e3779b9 + (location_hash << 6) + (location_hash >> 2);
+    const auto N = C.size();
+    body.resize(N);
+    for (size_t i = 0; i < N; ++i) {
+      body[i] = encode(C[i]->id, C.goal_indices[i]);
     }
-    uint indices_hash = C.goal_indices.size();
-    for (auto &idx : C.goal_indices) {
-      indices_hash ^=
-          idx + 0x9e3779b9 + (indices_hash << 6) + (indices_hash >> 2);
+    hash = C.hash;
+  }
+
+  void PackedConfig::unpack(const Graph *G, Config &C) const
+  {
+    const auto N = size();
+    C.resize(N);
+    C.goal_indices.resize(N);
+    for (size_t i = 0; i < N; ++i) {
+      C[i] = G->V[vertex_id(i)];
+      C.goal_indices[i] = goal_index(i);
+    }
+    C.hash = hash;
+  }
+
+  uint zobrist_hash(const Config &C)
+  {
+    uint hash = 0;
+    for (size_t i = 0; i < C.size(); ++i) {
+      hash ^= zobrist_key(i, C[i], C.goal_indices[i]);
     }
-    return hash_two_ints(location_hash, indices_hash);
+    return hash;
   }
 
+  uint ConfigHasher::operator()(const Config &C) const { return C.hash; }
+
   std::ostream &operator<<(std::ostream &os, const Vertex *v)
   {
     if (v == nullptr) {
@@ -155,6 +249,17 @@ namespace lacam
     return os;
   }
 
+  std::ostream &operator<<(std::ostream &os, const PackedConfig &Q)
+  {
+    os << "{ ";
+    for (size_t i = 0; i < Q.size(); ++i) os << Q.vertex_id(i) << " ";
+    os << "} ";
+    os << "{ ";
+    for (size_t i = 0; i < Q.size(); ++i) os << Q.goal_index(i) << " ";
+    os << "}";
+    return os;
+  }
+
   std::ostream &operator<<(std::ostream &os, const Paths &paths)
   {
     for (auto i = 0; i < paths.size(); ++i) {
@@ -181,4 +286,19 @@ namespace lacam
     return false;
   }
 
+  bool has_following_conflict(const PackedConfig &c_from,
+                              const PackedConfig &c_to,
+                              std::vector<int> &occupied)
+  {
+    const int N = c_from.size();
+    for (auto i = 0; i < N; ++i) occupied[c_from.vertex_id(i)] = i;
+    auto conflict = false;
+    for (auto i = 0; i < N && !conflict; ++i) {
+      const auto j = occupied[c_to.vertex_id(i)];
+      conflict = (j != -1 && j != i);
+    }
+    for (auto i = 0; i < N; ++i) occupied[c_from.vertex_id(i)] = -1;
+    return conflict;
+  }
+
 }  // namespace lacam
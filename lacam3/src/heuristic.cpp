@@ -16,4 +16,12 @@ namespace lacam
     return cost;
   }
 
+  int Heuristic::get(const PackedConfig &Q) const
+  {
+    auto cost = 0;
+    for (size_t i = 0; i < ins->N; ++i)
+      cost += D->get(i, Q.goal_index(i), Q.vertex_id(i));
+    return cost;
+  }
+
 }  // namespace lacam
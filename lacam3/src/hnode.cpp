@@ -7,37 +7,43 @@ namespace lacam
 
   int HNode::COUNT = 0;
 
-  HNode::HNode(Config _C, DistTableMultiGoal *D, HNode *_parent, int _g, int _h)
-      : C(_C),
+  HNode::HNode(const PackedConfig &_C, DistTableMultiGoal *D, HNode *_parent,
+               int _g, int _h, int _id)
+      : id(_id),
+        C(_C),
         parent(_parent),
         neighbor(),
         g(_g),
         h(_h),
         f(g + h),
-        priorities(C.size(), 0),
-        order(C.size(), 0),
-        search_tree(std::queue<LNode *>())
+        priorities(),
+        order(),
+        search_tree(),
+        search_tree_head(0)
   {
     ++COUNT;
 
-    search_tree.push(new LNode());
-    const auto N = C.size();
+    search_tree.emplace_back();
 
-    // update neighbor
-    if (parent != nullptr) {
-      neighbor.insert(parent);
-      parent->neighbor.insert(this);
-    }
+    set_priorities(D);
+  }
+
+  void HNode::set_priorities(DistTableMultiGoal *D)
+  {
+    const auto N = C.size();
+    priorities.resize(N);
+    order.resize(N);
 
     // set priorities
-    if (parent == nullptr) {
-      // initialize
+    if (parent == nullptr || parent->priorities.empty()) {
+      // initialize, also used when the parent has released its arrays
       for (auto i = 0; i < N; ++i)
-        priorities[i] = (float)D->get(i, C.goal_indices[i], C[i]) / 10000;
+        priorities[i] =
+            (float)D->get(i, C.goal_index(i), C.vertex_id(i)) / 10000;
     } else {
       // dynamic priorities, akin to PIBT
       for (auto i = 0; i < N; ++i) {
-        if (D->get(i, C.goal_indices[i], C[i]) != 0) {
+        if (D->get(i, C.goal_index(i), C.vertex_id(i)) != 0) {
           priorities[i] = parent->priorities[i] + 1;
         } else {
           priorities[i] = parent->priorities[i] - (int)parent->priorities[i];
@@ -51,26 +57,44 @@ namespace lacam
               [&](int i, int j) { return priorities[i] > priorities[j]; });
   }
 
-  HNode::~HNode()
+  void HNode::release_lowlevel(const bool restart)
   {
-    while (!search_tree.empty()) {
-      delete search_tree.front();
-      search_tree.pop();
-    }
+    // an exhausted low-level search stays exhausted
+    const auto unfinished = search_tree_head < search_tree.size();
+    std::deque<LNode>().swap(search_tree);
+    search_tree_head = 0;
+    std::vector<float>().swap(priorities);
+    std::vector<int>().swap(order);
+    if (restart && unfinished) search_tree.emplace_back();
   }
 
-  LNode *HNode::get_next_lowlevel_node(std::mt19937 &MT)
+  size_t HNode::lowlevel_bytes() const
   {
-    if (search_tree.empty()) return nullptr;
+    return search_tree.size() * sizeof(LNode) +
+           priorities.capacity() * sizeof(float) +
+           order.capacity() * sizeof(int);
+  }
 
-    auto L = search_tree.front();
-    search_tree.pop();
+  HNode::~HNode() {}
+
+  LNode *HNode::get_next_lowlevel_node(RNG &MT, const Graph *G,
+                                       DistTableMultiGoal *D)
+  {
+    if (search_tree_head == search_tree.size()) return nullptr;
+    if (order.empty()) set_priorities(D);  // released before
+
+    // references to deque elements are stable against emplace_back
+    const auto L = &search_tree[search_tree_head++];
     if (L->depth < C.size()) {
       auto i = order[L->depth];
-      auto cands = C[i]->neighbor;
-      cands.push_back(C[i]);
-      std::shuffle(cands.begin(), cands.end(), MT);  // randomize
-      for (auto u : cands) search_tree.push(new LNode(L, i, u));
+      const auto v = G->V[C.vertex_id(i)];
+      auto cands = std::array<Vertex *, 5>();
+      const auto K = v->candidates.size();  // neighbors and v itself
+      std::copy(v->candidates.begin(), v->candidates.end(), cands.begin());
+      for (auto k = (int)K - 1; k > 0; --k) {  // randomize
+        std::swap(cands[k], cands[get_random_int(MT, 0, k)]);
+      }
+      for (size_t k = 0; k < K; ++k) search_tree.emplace_back(L, i, cands[k]);
     }
     return L;
   }
@@ -82,13 +106,24 @@ namespace lacam
     return os;
   }
 
-  bool CompareHNodePointers::operator()(const HNode *l, const HNode *r) const
+  static bool compare_edge(const HEdge &e, const HNode *H)
   {
-    const auto N = l->C.size();
-    for (auto i = 0; i < N; ++i) {
-      if (l->C[i] != r->C[i]) return l->C[i]->id < r->C[i]->id;
-    }
-    return false;
+    return e.to->id < H->id;
+  }
+
+  bool HNode::is_neighbor(const HNode *H) const
+  {
+    auto it = std::lower_bound(neighbor.begin(), neighbor.end(), H,
+                               compare_edge);
+    return it != neighbor.end() && it->to == H;
+  }
+
+  void HNode::add_neighbor(HNode *H, const bool feasible)
+  {
+    auto it = std::lower_bound(neighbor.begin(), neighbor.end(), H,
+                               compare_edge);
+    if (it != neighbor.end() && it->to == H) return;
+    neighbor.insert(it, HEdge{H, feasible});
   }
 
 }  // namespace lacam
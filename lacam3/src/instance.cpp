@@ -52,9 +52,23 @@ namespace lacam
     }
   }
 
-  // for load instance
-  static const std::regex r_instance =
-      std::regex(R"(\d+\t.+\.map\t\d+\t\d+\t(\d+)\t(\d+)\t(\d+)\t(\d+)\t.+)");
+  // one line of a scenario file,
+  // bucket \t map \t width \t height \t x_s \t y_s \t x_g \t y_g \t dist
+  static bool parse_scen_line(std::string_view line, int &x_s, int &y_s,
+                              int &x_g, int &y_g)
+  {
+    int tmp;
+    if (!parse_uint(pop_field(line), tmp)) return false;
+    const auto map_name = pop_field(line);
+    return map_name.size() > 4 &&
+           map_name.substr(map_name.size() - 4) == ".map" &&
+           parse_uint(pop_field(line), tmp) &&
+           parse_uint(pop_field(line), tmp) &&
+           parse_uint(pop_field(line), x_s) &&
+           parse_uint(pop_field(line), y_s) &&
+           parse_uint(pop_field(line), x_g) &&
+           parse_uint(pop_field(line), y_g) && !line.empty();
+  }
 
   Instance::Instance(const std::string &scen_filename,
                      const std::string &map_filename, const int _N)
@@ -64,23 +78,17 @@ namespace lacam
         delete_graph_after_used(true)
   {
     // load start-goal pairs
-    std::ifstream file(scen_filename);
-    if (!file) {
+    const auto file = MappedFile(scen_filename);
+    if (file.data == nullptr) {
       info(0, 0, scen_filename, " is not found");
       return;
     }
-    std::string line;
-    std::smatch results;
-
-    while (getline(file, line)) {
-      // for CRLF coding
-      if (*(line.end() - 1) == 0x0d) line.pop_back();
-
-      if (std::regex_match(line, results, r_instance)) {
-        auto x_s = std::stoi(results[1].str());
-        auto y_s = std::stoi(results[2].str());
-        auto x_g = std::stoi(results[3].str());
-        auto y_g = std::stoi(results[4].str());
+    auto buf = std::string_view(file.data, file.size);
+    std::string_view line;
+
+    while (pop_line(buf, line)) {
+      int x_s, y_s, x_g, y_g;
+      if (parse_scen_line(line, x_s, y_s, x_g, y_g)) {
         if (x_s < 0 || G->width <= x_s || x_g < 0 || G->width <= x_g) continue;
         if (y_s < 0 || G->height <= y_s || y_g < 0 || G->height <= y_g)
           continue;
@@ -105,6 +113,12 @@ namespace lacam
     auto MT = std::mt19937(seed);
     // random assignment
     const auto K = G->size();
+    // draw cells in grid order so that the vertex numbering does not matter
+    auto cells = std::vector<Vertex *>();
+    cells.reserve(K);
+    for (auto v : G->U) {
+      if (v != nullptr) cells.push_back(v);
+    }
 
     // set starts
     auto s_indexes = std::vector<int>(K);
@@ -113,7 +127,7 @@ namespace lacam
     int i = 0;
     while (true) {
       if (i >= K) return;
-      starts.push_back(G->V[s_indexes[i]], 0);
+      starts.push_back(cells[s_indexes[i]], 0);
       if (starts.size() == N) break;
       ++i;
     }
@@ -125,7 +139,7 @@ namespace lacam
     int j = 0;
     while (true) {
       if (j >= K) return;
-      const auto vp = G->V[g_indexes[j]];
+      const auto vp = cells[g_indexes[j]];
       goal_sequences.push_back(std::vector<Vertex *>{vp});
       if (goal_sequences.size() == N) break;
       ++j;
@@ -138,6 +152,19 @@ namespace lacam
       info(1, verbose, "invalid N, check instance");
       return false;
     }
+    // limits of PackedConfig used in the search
+    if (G->size() > PackedConfig::MAX_VERTICES) {
+      info(1, verbose, "too many vertices (", G->size(), "), at most ",
+           PackedConfig::MAX_VERTICES, " are supported");
+      return false;
+    }
+    for (const auto &goals : goal_sequences) {
+      if ((int)goals.size() > PackedConfig::MAX_GOAL_INDEX) {
+        info(1, verbose, "too long goal sequence (", goals.size(),
+             "), at most ", PackedConfig::MAX_GOAL_INDEX, " are supported");
+        return false;
+      }
+    }
     return true;
   }
 
@@ -159,4 +186,13 @@ namespace lacam
     return true;
   }
 
+  bool Instance::is_goal_config(const PackedConfig &C) const
+  {
+    if (!enough_goals_reached(C, get_total_goals())) return false;
+    for (uint i = 0; i < N; i++) {
+      if (C.vertex_id(i) != goal_sequences[i].back()->id) return false;
+    }
+    return true;
+  }
+
 }  // namespace lacam
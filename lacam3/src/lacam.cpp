@@ -6,6 +6,7 @@ namespace lacam
   Solution solve(const Instance &ins, const std::optional<int> threshold,
                  int verbose, const Deadline *deadline, const int seed)
   {
+    if (!ins.is_valid(verbose)) return Solution();
     info(1, verbose, deadline, "pre-processing");
     auto planner = Planner(&ins, threshold, verbose, deadline, seed);
     return planner.solve();
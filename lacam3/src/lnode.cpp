@@ -5,14 +5,15 @@ namespace lacam
 
   int LNode::COUNT = 0;
 
-  LNode::LNode() : who(), where(), depth(0) { ++COUNT; }
+  LNode::LNode() : parent(nullptr), who(-1), where(nullptr), depth(0)
+  {
+    ++COUNT;
+  }
 
-  LNode::LNode(LNode *parent, int i, Vertex *v)
-      : who(parent->who), where(parent->where), depth(parent->depth + 1)
+  LNode::LNode(const LNode *_parent, int i, Vertex *v)
+      : parent(_parent), who(i), where(v), depth(parent->depth + 1)
   {
     ++COUNT;
-    who.push_back(i);
-    where.push_back(v);
   }
 
   LNode::~LNode(){};
@@ -4,9 +4,11 @@ namespace lacam
 {
 
   PIBT::PIBT(const Instance *_ins, DistTableMultiGoal *_D, int seed,
-             Scatter *_scatter, bool _allow_following)
+             Scatter *_scatter, bool _allow_following, int stream)
       : ins(_ins),
-        MT(std::mt19937(seed)),
+        id(stream),
+        MT_calls(seed, stream),
+        MT(),
         N(ins->N),
         V_size(ins->G->size()),
         D(_D),
@@ -14,34 +16,92 @@ namespace lacam
         occupied_now(V_size, NO_AGENT),
         occupied_next(V_size, NO_AGENT),
         C_next(N, std::array<Vertex *, 5>()),
-        tie_breakers(V_size, 0),
+        inheritance(),
         scatter(_scatter),
-        allow_following(_allow_following)
+        allow_following(_allow_following),
+        cancellation(nullptr),
+        lower_bounds(N, 0),
+        settled()
   {
+    // each agent appears at most once in a chain
+    inheritance.reserve(N);
+    settled.reserve(N);
+
+    // choose the specialization once
+    if (allow_following) {
+      if (scatter != nullptr) {
+        bind<true, true>();
+      } else {
+        bind<true, false>();
+      }
+    } else {
+      if (scatter != nullptr) {
+        bind<false, true>();
+      } else {
+        bind<false, false>();
+      }
+    }
   }
 
   PIBT::~PIBT() {}
 
+  void PIBT::Cancellation::update(const int f, const int id)
+  {
+    const auto val = pack(f, id);
+    auto cur = best.load(std::memory_order_relaxed);
+    while (val < cur && !best.compare_exchange_weak(cur, val)) {
+    }
+  }
+
+  template <bool ALLOW_FOLLOWING, bool USE_SCATTER>
+  void PIBT::bind()
+  {
+    set_new_config_impl =
+        &PIBT::set_new_config_specialized<ALLOW_FOLLOWING, USE_SCATTER>;
+    funcPIBT_impl = &PIBT::funcPIBT_specialized<ALLOW_FOLLOWING, USE_SCATTER>;
+  }
+
   bool PIBT::set_new_config(const Config &Q_from, Config &Q_to,
                             const std::vector<int> &order)
   {
-    bool success = true;
+    return (this->*set_new_config_impl)(Q_from, Q_to, order);
+  }
+
+  bool PIBT::funcPIBT(const int i, const int i_caller, const Config &Q_from,
+                      Config &Q_to)
+  {
+    return (this->*funcPIBT_impl)(i, i_caller, Q_from, Q_to);
+  }
+
+  template <bool ALLOW_FOLLOWING, bool USE_SCATTER>
+  bool PIBT::set_new_config_specialized(const Config &Q_from, Config &Q_to,
+                                        const std::vector<int> &order)
+  {
+    // one draw per call, regardless of where the call ends
+    MT = RNG(MT_calls());
 
     // set occupied_now (must all be set before checking constraints to properly
-    // check for following conflicts)
+    // check for following conflicts), and lower bounds of f
+    auto f_lb = 0;
     for (auto i = 0; i < N; ++i) {
       occupied_now[Q_from[i]->id] = i;
+      if (cancellation != nullptr) {
+        lower_bounds[i] = get_cost_lower_bound(i, Q_from, Q_to);
+        f_lb += lower_bounds[i];
+      }
     }
+    bool success =
+        cancellation == nullptr || !cancellation->is_hopeless(f_lb, id);
 
     // constraints check and set occupied_next
-    for (auto i = 0; i < N; ++i) {
+    for (auto i = 0; success && i < N; ++i) {
       if (Q_to[i] != nullptr) {
         // vertex conflict
         if (occupied_next[Q_to[i]->id] != NO_AGENT) {
           success = false;
           break;
         }
-        if (allow_following) {
+        if (ALLOW_FOLLOWING) {
           // swap conflict
           auto j = occupied_now[Q_to[i]->id];
           if (j != NO_AGENT && j != i && Q_to[j] == Q_from[i]) {
@@ -57,15 +117,33 @@ namespace lacam
           }
         }
         occupied_next[Q_to[i]->id] = i;
+        if (cancellation != nullptr) {
+          f_lb += get_cost(i, Q_from, Q_to) - lower_bounds[i];
+        }
       }
     }
+    // the constraints are common, no candidate is feasible
+    if (!success && cancellation != nullptr) cancellation->cancel_all();
 
     if (success) {
       for (auto i : order) {
-        if (Q_to[i] == nullptr && !funcPIBT(i, NO_AGENT, Q_from, Q_to)) {
+        if (Q_to[i] != nullptr) continue;
+        settled.clear();
+        if (!funcPIBT_specialized<ALLOW_FOLLOWING, USE_SCATTER>(i, NO_AGENT,
+                                                                Q_from, Q_to)) {
           success = false;
           break;
         }
+        // abandon the rollout when it cannot be the best candidate
+        if (cancellation != nullptr) {
+          for (auto j : settled) {
+            f_lb += get_cost(j, Q_from, Q_to) - lower_bounds[j];
+          }
+          if (cancellation->is_hopeless(f_lb, id)) {
+            success = false;
+            break;
+          }
+        }
       }
     }
 
@@ -78,100 +156,181 @@ namespace lacam
     return success;
   }
 
-  bool PIBT::funcPIBT(const int i, const int i_caller, const Config &Q_from,
-                      Config &Q_to)
+  template <bool ALLOW_FOLLOWING, bool USE_SCATTER>
+  bool PIBT::funcPIBT_specialized(const int i_root, const int i_caller,
+                                  const Config &Q_from, Config &Q_to)
   {
-    const auto K = Q_from[i]->neighbor.size();
+    // a success settles the whole chain at once,
+    // while a failure resumes the caller with its next candidate
+    inheritance.clear();
+    auto i = i_root;
+    auto k = 0;
+    auto num_candidates = 0;
+    auto i_parent = i_caller;  // to set up a new frame, or -1 on resuming
 
-    // exploit scatter data
-    Vertex *prioritized_vertex = nullptr;
-    if (scatter != nullptr) {
-      const auto& goal_index = Q_from.goal_indices[i];
-      const auto& data_for_this_goal = scatter->scatter_data_labeled[i][goal_index];
-      auto itr_s = data_for_this_goal.find(Q_from[i]->id);
-      if (itr_s != data_for_this_goal.end()) {
-        prioritized_vertex = itr_s->second;
+    while (true) {
+      if (i_parent != -1) {
+        num_candidates = set_candidates<ALLOW_FOLLOWING, USE_SCATTER>(
+            i, i_parent, Q_from);
       }
-    }
+      auto j_next = NO_AGENT;  // agent inheriting the priority
+      auto aborted = false;
 
-    // set C_next
-    for (size_t k = 0; k < K; ++k) {
-      auto u = Q_from[i]->neighbor[k];
-      C_next[i][k] = u;
-      tie_breakers[u->id] = get_random_float(MT);  // set tie-breaker
-    }
-    size_t num_candidates = K;
-    if (i_caller == NO_AGENT || allow_following) {
-      C_next[i][K] = Q_from[i];
-      num_candidates++;
-    }
+      // main loop
+      for (; k < num_candidates; ++k) {
+        auto u = C_next[i][k];
 
-    // sort C_next
-    std::sort(
-        C_next[i].begin(), C_next[i].begin() + num_candidates,
-        [&](Vertex *const v, Vertex *const u) {
-          if (v == prioritized_vertex) return true;
-          if (u == prioritized_vertex) return false;
-          return D->get(i, Q_from.goal_indices[i], v) + tie_breakers[v->id] <
-                 D->get(i, Q_from.goal_indices[i], u) + tie_breakers[u->id];
-        });
-
-    // main loop
-    for (size_t k = 0; k < num_candidates; ++k) {
-      auto u = C_next[i][k];
-
-      // avoid vertex conflicts
-      if (occupied_next[u->id] != NO_AGENT) continue;
-
-      const auto j = occupied_now[u->id];
-      if (allow_following) {
-        // avoid swap conflicts with constraints
-        if (j != NO_AGENT && Q_to[j] == Q_from[i]) continue;
-
-        // reserve next location
-        occupied_next[u->id] = i;
-        Q_to[i] = u;
-
-        // priority inheritance
-        if (j != NO_AGENT && u != Q_from[i] && Q_to[j] == nullptr &&
-            !funcPIBT(j, NO_AGENT, Q_from, Q_to))
-          continue;
-
-        // success to plan next one step
-        return true;
-      } else {
-        // avoid following conflicts
-        if (j != NO_AGENT && j != i) {
-          if (Q_to[j] == nullptr) {
-            // preemptively reserve current location
-            if (occupied_next[Q_from[i]->id] != NO_AGENT) {
-              info(1, 1, "agent-", i, " trying to preemptively reserve vertex-",
-                   u->id, ", but it is already reserved by agent-",
-                   occupied_next[Q_from[i]->id]);
-              return false;
-            }
-            occupied_next[Q_from[i]->id] = i;
-            Q_to[i] = Q_from[i];
+        // avoid vertex conflicts
+        if (occupied_next[u->id] != NO_AGENT) continue;
+
+        const auto j = occupied_now[u->id];
+        if (ALLOW_FOLLOWING) {
+          // avoid swap conflicts with constraints
+          if (j != NO_AGENT && Q_to[j] == Q_from[i]) continue;
+
+          // reserve next location
+          occupied_next[u->id] = i;
+          Q_to[i] = u;
+
+          // priority inheritance
+          if (j != NO_AGENT && u != Q_from[i] && Q_to[j] == nullptr) {
+            j_next = j;
+            break;
+          }
 
-            if (funcPIBT(j, i, Q_from, Q_to)) return true;
+          // success to plan next one step
+          settled.push_back(i);
+          for (const auto &frame : inheritance) settled.push_back(frame.i);
+          return true;
+        } else {
+          // avoid following conflicts
+          if (j != NO_AGENT && j != i) {
+            if (Q_to[j] == nullptr) {
+              // preemptively reserve current location
+              if (occupied_next[Q_from[i]->id] != NO_AGENT) {
+                info(1, 1, "agent-", i,
+                     " trying to preemptively reserve vertex-", u->id,
+                     ", but it is already reserved by agent-",
+                     occupied_next[Q_from[i]->id]);
+                aborted = true;
+                break;
+              }
+              occupied_next[Q_from[i]->id] = i;
+              Q_to[i] = Q_from[i];
 
-            // revert if priority inheritance failed
-            occupied_next[Q_from[i]->id] = NO_AGENT;
-            Q_to[i] = nullptr;
+              // priority inheritance
+              j_next = j;
+              break;
+            }
+            continue;
           }
-          continue;
+          // success
+          occupied_next[u->id] = i;
+          Q_to[i] = u;
+          settled.push_back(i);
+          for (const auto &frame : inheritance) settled.push_back(frame.i);
+          return true;
         }
-        // success
-        occupied_next[u->id] = i;
-        Q_to[i] = u;
-        return true;
+      }
+
+      if (j_next != NO_AGENT) {
+        inheritance.push_back({i, k, num_candidates});
+        i_parent = ALLOW_FOLLOWING ? NO_AGENT : i;
+        i = j_next;
+        k = 0;
+        continue;
+      }
+
+      if (!aborted) {
+        // failed to secure node, remain at current location
+        occupied_next[Q_from[i]->id] = i;
+        Q_to[i] = Q_from[i];
+        settled.push_back(i);
+      }
+
+      // back to the caller
+      if (inheritance.empty()) break;
+      i = inheritance.back().i;
+      k = inheritance.back().k + 1;
+      num_candidates = inheritance.back().num_candidates;
+      i_parent = -1;
+      inheritance.pop_back();
+      if (!ALLOW_FOLLOWING) {
+        // revert if priority inheritance failed
+        occupied_next[Q_from[i]->id] = NO_AGENT;
+        Q_to[i] = nullptr;
       }
     }
 
-    // failed to secure node, remain at current location
-    occupied_next[Q_from[i]->id] = i;
-    Q_to[i] = Q_from[i];
     return false;
   }
 
+  template <bool ALLOW_FOLLOWING, bool USE_SCATTER>
+  int PIBT::set_candidates(const int i, const int i_caller,
+                           const Config &Q_from)
+  {
+    const auto &cands = Q_from[i]->candidates;  // neighbors, then itself
+    const auto K = (int)cands.size() - 1;
+
+    auto num_candidates = K;
+    if (ALLOW_FOLLOWING || i_caller == NO_AGENT) num_candidates++;
+
+    // keys for sorting, distances looked up once per candidate,
+    // with tie-breakers drawn at once
+    float rands[5];
+    MT.get_floats(rands, num_candidates);
+    const auto g = Q_from.goal_indices[i];
+    auto keys = std::array<std::pair<float, Vertex *>, 5>();
+    for (auto k = 0; k < num_candidates; ++k) {
+      auto u = cands[k];
+      keys[k] = {D->get(i, g, u) + rands[k], u};
+    }
+
+    // exploit scatter data, the prioritized vertex comes first
+    if (USE_SCATTER) {
+      const auto &data_for_this_goal = scatter->scatter_data_labeled[i][g];
+      auto itr_s = data_for_this_goal.find(Q_from[i]->id);
+      if (itr_s != data_for_this_goal.end()) {
+        for (auto k = 0; k < num_candidates; ++k) {
+          if (keys[k].second == itr_s->second) {
+            keys[k].first = -std::numeric_limits<float>::infinity();
+          }
+        }
+      }
+    }
+
+    // sort C_next
+    // insertion sort, as std::sort does for such few elements
+    for (auto k = 1; k < num_candidates; ++k) {
+      const auto key = keys[k];
+      auto l = k;
+      for (; l > 0 && key.first < keys[l - 1].first; --l) keys[l] = keys[l - 1];
+      keys[l] = key;
+    }
+    for (auto k = 0; k < num_candidates; ++k) C_next[i][k] = keys[k].second;
+
+    return num_candidates;
+  }
+
+  int PIBT::get_cost(const int i, const Config &Q_from, const Config &Q_to)
+  {
+    const auto &goal_seq = ins->goal_sequences[i];
+    const auto last = (int)goal_seq.size() - 1;
+    const auto g_from = goal_seq[std::min(Q_from.goal_indices[i], last)];
+    const auto g_to = goal_seq[std::min(Q_to.goal_indices[i], last)];
+    return (Q_from[i] != g_from || Q_to[i] != g_to) +
+           D->get(i, Q_to.goal_indices[i], Q_to[i]);
+  }
+
+  int PIBT::get_cost_lower_bound(const int i, const Config &Q_from,
+                                 const Config &Q_to)
+  {
+    // distances change by at most one per step
+    const auto &goal_seq = ins->goal_sequences[i];
+    const auto last = (int)goal_seq.size() - 1;
+    const auto g_from = goal_seq[std::min(Q_from.goal_indices[i], last)];
+    return (Q_from[i] != g_from) +
+           std::max(0, D->get(i, Q_to.goal_indices[i], Q_from[i]) - 1);
+  }
+
 }  // namespace lacam
@@ -12,6 +12,7 @@ namespace lacam
   bool Planner::FLG_MULTI_THREAD = true;
   int Planner::SCATTER_MARGIN = 10;
   int Planner::PIBT_NUM = 10;
+  bool Planner::FLG_BATCHED_PIBT = false;
   bool Planner::FLG_REFINER = true;
   int Planner::REFINER_NUM = 4;
   bool Planner::FLG_SCATTER = true;
@@ -21,6 +22,7 @@ namespace lacam
   float Planner::RECURSIVE_RATE = 0.2;
   double Planner::RECURSIVE_TIME_LIMIT = 1000;
   bool Planner::FLG_ALLOW_FOLLOWING = false;
+  size_t Planner::MEMORY_LIMIT = 0;
 
   std::string Planner::MSG;
   int Planner::CHECKPOINTS_DURATION = 5000;
@@ -30,12 +32,13 @@ namespace lacam
 
   Planner::Planner(const Instance *_ins, std::optional<int> _threshold,
                    int _verbose, const Deadline *_deadline, int _seed,
-                   int _depth, DistTableMultiGoal *_D)
+                   int _depth, DistTableMultiGoal *_D,
+                   ThreadPool *_worker_pool)
       : ins(_ins),
         threshold(_threshold),
         deadline(_deadline),
         seed(_seed),
-        MT(std::mt19937(seed)),
+        MT(seed),
         verbose(_verbose),
         depth(_depth),
         N(ins->N),
@@ -44,17 +47,43 @@ namespace lacam
         delete_dist_table_after_used(_D == nullptr),
         heuristic(new Heuristic(ins, D)),
         scatter(nullptr),
+        pibts(),
+        batched_pibt(nullptr),
+        cancellation(),
+        worker_pool(_worker_pool),
+        delete_worker_pool_after_used(false),
         seed_refiner(0),
+        MT_refiner(seed, PIBT_NUM),
         refiner_pool(),
         OPEN(),
         EXPLORED(),
         H_init(nullptr),
         H_goal(nullptr),
+        hnode_pool(),
+        Q_from(),
+        Q_to(N, nullptr),
+        Q_to_packed(),
+        Q_cands(),
+        f_vals(),
+        rewrite_queue(),
+        occupied(V_size, -1),
+        lowlevel_bytes(0),
+        memory_limit_reached(false),
+        num_memory_reductions(0),
         search_iter(0),
         time_initial_solution(-1),
         cost_initial_solution(-1),
         checkpoints()
   {
+    // callers are expected to check Instance::is_valid beforehand
+    if (V_size > PackedConfig::MAX_VERTICES) {
+      throw std::invalid_argument("too many vertices for PackedConfig");
+    }
+    for (auto &goal_seq : ins->goal_sequences) {
+      if ((int)goal_seq.size() > PackedConfig::MAX_GOAL_INDEX) {
+        throw std::invalid_argument("too long goal sequence for PackedConfig");
+      }
+    }
   }
 
   Planner::~Planner()
@@ -62,23 +91,31 @@ namespace lacam
     if (heuristic != nullptr) delete heuristic;
     if (scatter != nullptr) delete scatter;
     for (auto &pibt : pibts) delete pibt;
+    if (batched_pibt != nullptr) delete batched_pibt;
+    if (delete_worker_pool_after_used) delete worker_pool;
     if (delete_dist_table_after_used) delete D;
   }
 
-  std::vector<int> calculate_goal_indices(const Instance *ins, const Config &c,
-                                          const Config &prev_config)
+  // only agents that moved or advanced their goal touch the hash
+  void calculate_goal_indices(const Instance *ins, Config &c,
+                              const Config &prev_config)
   {
-    auto goal_indices = prev_config.goal_indices;
+    c.goal_indices.resize(ins->N);
+    c.hash = prev_config.hash;
     for (size_t i = 0; i < ins->N; ++i) {
-      const auto current_location = c[i];
-      const auto goal_seq = ins->goal_sequences[i];
-      auto &goal_idx = goal_indices[i];
-      const auto next_goal = goal_seq[goal_indices[i]];
-      if (current_location == next_goal && goal_idx < (int)goal_seq.size()) {
+      const auto prev_location = prev_config[i];
+      const auto prev_goal_idx = prev_config.goal_indices[i];
+      const auto &goal_seq = ins->goal_sequences[i];
+      auto goal_idx = prev_goal_idx;
+      if (goal_idx < (int)goal_seq.size() && c[i] == goal_seq[goal_idx]) {
         goal_idx += 1;
       }
+      c.goal_indices[i] = goal_idx;
+      if (c[i] != prev_location || goal_idx != prev_goal_idx) {
+        c.hash ^= zobrist_key(i, prev_location, prev_goal_idx) ^
+                  zobrist_key(i, c[i], goal_idx);
+      }
     }
-    return goal_indices;
   }
 
   Solution Planner::solve()
@@ -88,8 +125,9 @@ namespace lacam
 
     // insert initial node
     auto C_init = ins->starts;
-    C_init.goal_indices = calculate_goal_indices(ins, C_init, C_init);
-    H_init = create_highlevel_node(C_init, nullptr);
+    C_init.hash = zobrist_hash(C_init);
+    calculate_goal_indices(ins, C_init, C_init);
+    H_init = create_highlevel_node(PackedConfig(C_init), nullptr);
     OPEN.push_front(H_init);
 
     set_scatter();
@@ -100,15 +138,24 @@ namespace lacam
       search_iter += 1;
       update_checkpoints();
 
+      // degrade gracefully instead of running out of memory
+      if (MEMORY_LIMIT > 0 && get_memory_usage() >= MEMORY_LIMIT &&
+          !reduce_memory_usage()) {
+        memory_limit_reached = true;
+        info(1, verbose, deadline, "memory limit reached");
+        break;
+      }
+
       // check pooled procedures
       refiner_pool.remove_if([&](auto &proc) {
         if ((proc).wait_for(TIME_ZERO) != std::future_status::ready)
           return false;
         apply_new_solution(proc.get());
         ++seed_refiner;
-        refiner_pool.emplace_back(std::async(std::launch::async,
-                                             &Planner::get_refined_plan, this,
-                                             backtrack(H_goal)));
+        MT_refiner.jump();
+        refiner_pool.emplace_back(std::async(
+            std::launch::async, &Planner::get_refined_plan, this,
+            backtrack(H_goal), seed_refiner, MT_refiner));
         return true;
       });
 
@@ -125,6 +172,7 @@ namespace lacam
       // check lower bounds
       if (H_goal != nullptr && H->f >= H_goal->f) {
         OPEN.pop_front();
+        if (MEMORY_LIMIT > 0) release_lowlevel(H, true);
         continue;
       }
 
@@ -143,33 +191,35 @@ namespace lacam
       }
 
       // low level search
-      auto L = H->get_next_lowlevel_node(MT);
+      const auto lowlevel_bytes_before = H->lowlevel_bytes();
+      auto L = H->get_next_lowlevel_node(MT, ins->G, D);
+      lowlevel_bytes += H->lowlevel_bytes() - lowlevel_bytes_before;
       if (L == nullptr) {
         OPEN.pop_front();
+        if (MEMORY_LIMIT > 0) release_lowlevel(H, false);
         continue;
       }
 
       // create successors at the high-level search
-      auto Q_to = Config(N, nullptr);
       auto res = set_new_config(H, L, Q_to);
-      Q_to.goal_indices = calculate_goal_indices(ins, Q_to, H->C);
-      delete L;
       if (!res) continue;
+      calculate_goal_indices(ins, Q_to, Q_from);
+      Q_to_packed.pack(Q_to);
 
       // check explored list
-      auto iter = EXPLORED.find(Q_to);
-      if (iter != EXPLORED.end()) {
+      auto H_known = EXPLORED.find(Q_to_packed);
+      if (H_known != nullptr) {
         // known configuration
-        rewrite(H, iter->second);
+        rewrite(H, H_known);
 
         if (get_random_float(MT) >= RANDOM_INSERT_PROB1) {
-          OPEN.push_front(iter->second);  // usual
+          OPEN.push_front(H_known);  // usual
         } else {
           OPEN.push_front(H_init);  // sometimes
         }
       } else {
         // new one -> insert
-        auto H_new = create_highlevel_node(Q_to, H);
+        auto H_new = create_highlevel_node(Q_to_packed, H);
         OPEN.push_front(H_new);
       }
     }
@@ -182,41 +232,83 @@ namespace lacam
     // end processing
     update_checkpoints();
     logging();
-    auto solution = backtrack(H_goal);        // obtain solution
-    for (auto p : EXPLORED) delete p.second;  // memory management
+    auto solution = backtrack(H_goal);  // obtain solution
+    EXPLORED.for_each([&](HNode *H) { hnode_pool.dispose(H); });
     return solution;
   }
 
-  HNode *Planner::create_highlevel_node(const Config &Q, HNode *parent)
+  HNode *Planner::create_highlevel_node(const PackedConfig &Q, HNode *parent)
   {
     auto g_val =
         (parent == nullptr) ? 0 : parent->g + get_edge_cost(parent->C, Q);
     auto h_val = heuristic->get(Q);
-    auto H_new = new HNode(Q, D, parent, g_val, h_val);
-    EXPLORED[Q] = H_new;
+    auto H_new =
+        hnode_pool.create(Q, D, parent, g_val, h_val, (int)EXPLORED.size());
+    EXPLORED.insert(H_new);
+    if (parent != nullptr) {
+      add_edge(parent, H_new);
+      add_edge(H_new, parent);
+    }
+    lowlevel_bytes += H_new->lowlevel_bytes();
     return H_new;
   }
 
+  void Planner::release_lowlevel(HNode *H, const bool restart)
+  {
+    lowlevel_bytes -= H->lowlevel_bytes();
+    H->release_lowlevel(restart);
+    lowlevel_bytes += H->lowlevel_bytes();
+  }
+
+  size_t Planner::get_memory_usage() const
+  {
+    // approximate, adjacency lists are not counted
+    return hnode_pool.bytes() + hnode_pool.num_live * N * sizeof(uint32_t) +
+           EXPLORED.slots.size() * sizeof(ExploredTable::Slot) +
+           OPEN.size() * sizeof(HNode *) + lowlevel_bytes;
+  }
+
+  bool Planner::reduce_memory_usage()
+  {
+    ++num_memory_reductions;
+    // release low-level search data of all nodes
+    EXPLORED.for_each([&](HNode *H) { release_lowlevel(H, true); });
+    const auto usage = get_memory_usage();
+    info(2, verbose, deadline, "release low-level search data, memory usage: ",
+         usage / 1024, "KB");
+    // continue only when there is enough room
+    return usage < MEMORY_LIMIT * 0.9;
+  }
+
   void Planner::apply_new_solution(const Solution &plan)
   {
     if (plan.empty()) return;
     info(3, verbose, deadline, "incorporate new solution");
 
     // forcibly insert configuration
-    HNode *H_from = EXPLORED[plan[0]];
+    // hashes are recomputed since plans may come from outside of the search
+    auto Q_unpacked = plan[0];
+    Q_unpacked.hash = zobrist_hash(Q_unpacked);
+    HNode *H_from = EXPLORED.find(PackedConfig(Q_unpacked));
+    if (H_from == nullptr) return;
     HNode *H_to = nullptr;
     for (size_t t = 1; t < plan.size(); ++t) {
-      auto &&Q = plan[t];
-      auto iter = EXPLORED.find(Q);
-      if (iter != EXPLORED.end()) {
+      Q_unpacked = plan[t];
+      Q_unpacked.hash = zobrist_hash(Q_unpacked);
+      const auto Q = PackedConfig(Q_unpacked);
+      H_to = EXPLORED.find(Q);
+      if (H_to != nullptr) {
         // known
-        H_to = iter->second;
         rewrite(H_from, H_to);
       } else {
         // new
         auto g_val = H_from->g + get_edge_cost(H_from->C, Q);
-        H_to = new HNode(Q, D, H_from, g_val, heuristic->get(Q));
-        EXPLORED[Q] = H_to;
+        H_to = hnode_pool.create(Q, D, H_from, g_val, heuristic->get(Q),
+                                 (int)EXPLORED.size());
+        EXPLORED.insert(H_to);
+        add_edge(H_from, H_to);
+        add_edge(H_to, H_from);
+        lowlevel_bytes += H_to->lowlevel_bytes();
         OPEN.push_front(H_to);
       }
       H_from = H_to;
@@ -228,7 +320,8 @@ namespace lacam
     std::vector<Config> plan;
     auto _H = H;
     while (_H != nullptr) {
-      plan.push_back(_H->C);
+      plan.emplace_back();
+      _H->C.unpack(ins->G, plan.back());
       _H = _H->parent;
     }
     std::reverse(plan.begin(), plan.end());
@@ -237,26 +330,44 @@ namespace lacam
 
   bool Planner::set_new_config(HNode *H, LNode *L, Config &Q_to)
   {
-    // worker-id, time -> configuration
-    auto Q_cands = std::vector<Config>(PIBT_NUM, Config(N, nullptr));
-    auto f_vals = std::vector<int>(PIBT_NUM, INT_MAX);
-
-    // parallel
-    auto worker = [&](int k) {
-      // set constraints
-      for (auto d = 0; d < L->depth; ++d) Q_cands[k][L->who[d]] = L->where[d];
-      // PIBT
-      auto res = pibts[k]->set_new_config(H->C, Q_cands[k], H->order);
-      if (res)
-        f_vals[k] =
-            get_edge_cost(H->C, Q_cands[k]) + heuristic->get(Q_cands[k]);
-    };
-    if (FLG_MULTI_THREAD && PIBT_NUM > 1) {
-      auto threads = std::vector<std::thread>();
-      for (auto k = 0; k < PIBT_NUM; ++k) threads.emplace_back(worker, k);
-      for (auto &th : threads) th.join();
+    H->C.unpack(ins->G, Q_from);
+
+    if (batched_pibt != nullptr) {
+      // all candidates at once, constraints are read from the first one
+      auto &Q_cand = Q_cands[0];
+      std::fill(Q_cand.begin(), Q_cand.end(), nullptr);
+      for (const LNode *l = L; l->parent != nullptr; l = l->parent) {
+        Q_cand[l->who] = l->where;
+      }
+      batched_pibt->set_new_configs(Q_from, Q_cands, H->order, lane_success);
+      for (auto k = 0; k < PIBT_NUM; ++k) {
+        f_vals[k] = lane_success[k] ? get_edge_cost(Q_from, Q_cands[k]) +
+                                          heuristic->get(Q_cands[k])
+                                    : INT_MAX;
+      }
     } else {
-      for (auto k = 0; k < PIBT_NUM; ++k) worker(k);
+      // parallel
+      auto worker = [&](int k) {
+        auto &Q_cand = Q_cands[k];
+        std::fill(Q_cand.begin(), Q_cand.end(), nullptr);
+        f_vals[k] = INT_MAX;
+        // set constraints, walking up the low-level tree
+        for (const LNode *l = L; l->parent != nullptr; l = l->parent) {
+          Q_cand[l->who] = l->where;
+        }
+        // PIBT, abandoned once it cannot beat the best candidate so far
+        auto res = pibts[k]->set_new_config(Q_from, Q_cand, H->order);
+        if (res) {
+          f_vals[k] = get_edge_cost(Q_from, Q_cand) + heuristic->get(Q_cand);
+          cancellation.update(f_vals[k], pibts[k]->id);
+        }
+      };
+      cancellation.reset();
+      if (worker_pool != nullptr) {
+        worker_pool->run(PIBT_NUM, worker);
+      } else {
+        for (auto k = 0; k < PIBT_NUM; ++k) worker(k);
+      }
     }
 
     // obtain the best score
@@ -278,29 +389,37 @@ namespace lacam
     }
   }
 
+  void Planner::add_edge(HNode *H_from, HNode *H_to)
+  {
+    if (H_from->is_neighbor(H_to)) return;
+    const auto feasible =
+        FLG_ALLOW_FOLLOWING ||
+        !has_following_conflict(H_from->C, H_to->C, occupied);
+    H_from->add_neighbor(H_to, feasible);
+  }
+
   void Planner::rewrite(HNode *H_from, HNode *H_to)
   {
     // update neighbors
-    H_from->neighbor.insert(H_to);
-
-    // Dijkstra
-    std::queue<HNode *> Q({H_from});  // queue is sufficient
-    while (!Q.empty()) {
-      auto n_from = Q.front();
-      Q.pop();
-      for (auto n_to : n_from->neighbor) {
+    add_edge(H_from, H_to);
+
+    // Dijkstra, queue is sufficient
+    rewrite_queue.clear();
+    rewrite_queue.push_back(H_from);
+    for (size_t head = 0; head < rewrite_queue.size(); ++head) {
+      auto n_from = rewrite_queue[head];
+      for (const auto &e : n_from->neighbor) {
+        if (!e.feasible) continue;
+        auto n_to = e.to;
         auto g_val = n_from->g + get_edge_cost(n_from->C, n_to->C);
-        bool conflict_free = FLG_ALLOW_FOLLOWING
-                                 ? true
-                                 : !has_following_conflict(n_from->C, n_to->C);
-        if (g_val < n_to->g && conflict_free) {
+        if (g_val < n_to->g) {
           if (n_to == H_goal)
             info(2, verbose, deadline, "cost update: ", H_goal->g, " -> ",
                  g_val);
           n_to->g = g_val;
           n_to->f = n_to->g + n_to->h;
           n_to->parent = n_from;
-          Q.push(n_to);
+          rewrite_queue.push_back(n_to);
           if (H_goal != nullptr && n_to->f < H_goal->f) OPEN.push_front(n_to);
         }
       }
@@ -323,6 +442,19 @@ namespace lacam
     return cost;
   }
 
+  int Planner::get_edge_cost(const PackedConfig &C1, const PackedConfig &C2)
+  {
+    auto cost = 0;
+    for (auto i = 0; i < N; ++i) {
+      const auto &goal_seq = ins->goal_sequences[i];
+      const auto last = (int)goal_seq.size() - 1;
+      const auto c1_goal = goal_seq[std::min(C1.goal_index(i), last)]->id;
+      const auto c2_goal = goal_seq[std::min(C2.goal_index(i), last)]->id;
+      if (C1.vertex_id(i) != c1_goal || C2.vertex_id(i) != c2_goal) cost += 1;
+    }
+    return cost;
+  }
+
   void Planner::set_scatter()
   {
     if (!FLG_SCATTER) return;
@@ -343,9 +475,24 @@ namespace lacam
 
   void Planner::set_pibt()
   {
+    Q_cands.assign(PIBT_NUM, Config(N, nullptr));
+    f_vals.assign(PIBT_NUM, INT_MAX);
+    if (FLG_BATCHED_PIBT) {
+      // same random streams as the threaded PIBTs below
+      batched_pibt = new BatchedPIBT(ins, D, PIBT_NUM, seed, scatter,
+                                     FLG_ALLOW_FOLLOWING, 1);
+      return;
+    }
     for (auto k = 0; k < PIBT_NUM; ++k) {
       pibts.emplace_back(
-          new PIBT(ins, D, k + seed, scatter, FLG_ALLOW_FOLLOWING));
+          new PIBT(ins, D, seed, scatter, FLG_ALLOW_FOLLOWING, k + 1));
+      // with a single candidate, there is nothing to compete with
+      if (PIBT_NUM > 1) pibts.back()->cancellation = &cancellation;
+    }
+    // the caller thread also works, hence PIBT_NUM - 1 workers
+    if (FLG_MULTI_THREAD && PIBT_NUM > 1 && worker_pool == nullptr) {
+      worker_pool = new ThreadPool(PIBT_NUM - 1);
+      delete_worker_pool_after_used = true;
     }
   }
 
@@ -357,14 +504,18 @@ namespace lacam
     info(2, verbose, deadline, "invoke refiners");
     for (auto k = 0; k < REFINER_NUM; ++k) {
       ++seed_refiner;
-      refiner_pool.emplace_back(std::async(
-          std::launch::async, &Planner::get_refined_plan, this, plan));
+      MT_refiner.jump();
+      refiner_pool.emplace_back(std::async(std::launch::async,
+                                           &Planner::get_refined_plan, this,
+                                           plan, seed_refiner, MT_refiner));
     }
   }
 
-  Solution Planner::get_refined_plan(const Solution &plan)
+  Solution Planner::get_refined_plan(const Solution &plan,
+                                     const int refiner_id, RNG MT_internal)
   {
-    auto MT_internal = std::mt19937(seed_refiner);
+    // a fresh seed for the inner solvers
+    const auto seed_internal = int(MT_internal() >> 33);
     if (depth < 1 && plan.size() > 3 &&
         get_random_float(MT_internal) < RECURSIVE_RATE) {
       // recursive LaCAM
@@ -377,16 +528,16 @@ namespace lacam
                                                 : deadline->time_limit_ms -
                                                       elapsed_ms(deadline)));
       auto planner_tmp = Planner(&ins_tmp, threshold, 0, &deadline_tmp,
-                                 seed_refiner, depth + 1, D);
-      info(4, verbose, deadline, "refiner-", planner_tmp.seed,
+                                 seed_internal, depth + 1, D, worker_pool);
+      info(4, verbose, deadline, "refiner-", refiner_id,
            "\tactivated (recursive LaCAM)");
       auto res = planner_tmp.solve();
-      info(4, verbose, deadline, "refiner-", planner_tmp.seed,
+      info(4, verbose, deadline, "refiner-", refiner_id,
            "\tcompleted (recursive LaCAM)");
       return res;
     } else if (RECURSIVE_RATE < 1.0) {
       // iterative refinement
-      return refine(ins, deadline, plan, D, seed_refiner, verbose - 4);
+      return refine(ins, deadline, plan, D, seed_internal, verbose - 4);
     } else {
       return Solution();
     }
@@ -411,6 +562,16 @@ namespace lacam
     MSG += "\nsearch_iteration=" + std::to_string(search_iter);
     MSG += "\nnum_high_level_node=" + std::to_string(HNode::COUNT);
     MSG += "\nnum_low_level_node=" + std::to_string(LNode::COUNT);
+    MSG += "\npool_high_level_node=" + std::to_string(hnode_pool.num_created);
+    MSG += "\npool_high_level_bytes=" + std::to_string(hnode_pool.bytes());
+    MSG += "\nmemory_usage=" + std::to_string(get_memory_usage());
+    MSG += "\nmemory_limit_reached=" + std::to_string(memory_limit_reached);
+    MSG += "\nmemory_reductions=" + std::to_string(num_memory_reductions);
+    MSG += "\npeak_rss_kb=" + std::to_string(get_peak_rss_kb());
+    MSG += "\ndist_table_setup_ms=" + std::to_string((int)D->setup_ms);
+    MSG += "\ndist_table_rows=" + std::to_string(D->num_rows());
+    MSG += "\ndist_table_bytes=" + std::to_string(D->bytes());
+    MSG += "\ndist_table_cached_rows=" + std::to_string(D->num_cached_rows());
 
     if (H_goal != nullptr && OPEN.empty()) {
       info(1, verbose, deadline, "solved optimally, cost:", H_goal->g);
@@ -12,7 +12,7 @@ namespace lacam
     info(0, verbose, deadline, "refiner-", seed, "\tactivated");
     // setup
     const auto N = ins->N;
-    auto MT = std::mt19937(seed);
+    auto MT = RNG(seed);
     auto paths = translateConfigsToPaths(solution);
     auto cost_before = get_sum_of_loss_paths(paths);
     std::vector<int> order(N, 0);
@@ -0,0 +1,117 @@
+#include "../include/thread_pool.hpp"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace lacam
+{
+
+  ThreadPool::ThreadPool(int num_workers, bool pin_to_cores)
+      : workers(), pending(), stop(false)
+  {
+    pending.reserve(16);
+#ifdef __linux__
+    // cores the process may run on, respecting taskset, cgroups, etc.
+    auto cores = std::vector<int>();
+    if (pin_to_cores) {
+      cpu_set_t allowed;
+      CPU_ZERO(&allowed);
+      if (sched_getaffinity(0, sizeof(cpu_set_t), &allowed) == 0) {
+        for (auto c = 0; c < CPU_SETSIZE; ++c) {
+          if (CPU_ISSET(c, &allowed)) cores.push_back(c);
+        }
+      }
+    }
+    // pin only when the caller and each worker can have their own core
+    const auto pin = num_workers < (int)cores.size();
+#endif
+    for (auto k = 0; k < num_workers; ++k) {
+      workers.emplace_back(&ThreadPool::worker_loop, this);
+#ifdef __linux__
+      // the caller stays unpinned, workers are spread over the cores
+      if (pin) {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(cores[k + 1], &cpuset);
+        pthread_setaffinity_np(workers.back().native_handle(),
+                               sizeof(cpu_set_t), &cpuset);
+      }
+#endif
+    }
+  }
+
+  ThreadPool::~ThreadPool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      stop = true;
+    }
+    cv_task.notify_all();
+    for (auto &th : workers) th.join();
+  }
+
+  bool ThreadPool::claim(Batch *batch, int &k)
+  {
+    if (batch->next >= batch->n) return false;
+    k = batch->next++;
+    if (batch->next == batch->n) {
+      pending.erase(std::find(pending.begin(), pending.end(), batch));
+    }
+    return true;
+  }
+
+  void ThreadPool::work(Batch *batch, int k)
+  {
+    batch->invoke(batch->fn, k);
+    // the batch lives on the caller's stack and may be gone as soon as the
+    // last task is reported, hence n is read beforehand
+    const auto n = batch->n;
+    if (batch->done.fetch_add(1) + 1 == n) {
+      std::lock_guard<std::mutex> lock(mtx);
+      cv_done.notify_all();
+    }
+  }
+
+  void ThreadPool::execute(Batch *batch)
+  {
+    if (batch->n <= 0) return;
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      pending.push_back(batch);
+    }
+    cv_task.notify_all();
+
+    // participate
+    while (true) {
+      int k;
+      {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (!claim(batch, k)) break;
+      }
+      work(batch, k);
+    }
+
+    // wait for tasks claimed by workers
+    std::unique_lock<std::mutex> lock(mtx);
+    cv_done.wait(lock, [&] { return batch->done == batch->n; });
+  }
+
+  void ThreadPool::worker_loop()
+  {
+    while (true) {
+      Batch *batch;
+      int k;
+      {
+        std::unique_lock<std::mutex> lock(mtx);
+        cv_task.wait(lock, [&] { return stop || !pending.empty(); });
+        if (stop) return;
+        batch = pending.front();
+        claim(batch, k);
+      }
+      work(batch, k);
+    }
+  }
+
+}  // namespace lacam
@@ -1,5 +1,11 @@
 #include "../include/utils.hpp"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 namespace lacam
 {
 
@@ -42,22 +48,53 @@ namespace lacam
     return deadline->elapsed_ms() > deadline->time_limit_ms;
   }
 
-  float get_random_float(std::mt19937 &MT, float from, float to)
+  RNG::RNG(const uint64_t seed, const int stream)
+  {
+    // splitmix64
+    auto x = seed;
+    for (auto &v : s) {
+      auto z = (x += 0x9e3779b97f4a7c15);
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+      v = z ^ (z >> 31);
+    }
+    for (auto k = 0; k < stream; ++k) jump();
+  }
+
+  void RNG::jump()
+  {
+    static const uint64_t JUMP[] = {0x180ec6d33cfd0aba, 0xd5a61266f0c9392c,
+                                    0xa9582618e03fc9aa, 0x39abdc4529b1661c};
+    uint64_t t[4] = {0, 0, 0, 0};
+    for (auto j : JUMP) {
+      for (auto b = 0; b < 64; ++b) {
+        if (j & (uint64_t(1) << b)) {
+          for (auto k = 0; k < 4; ++k) t[k] ^= s[k];
+        }
+        operator()();
+      }
+    }
+    for (auto k = 0; k < 4; ++k) s[k] = t[k];
+  }
+
+  float get_random_float(RNG &MT, float from, float to)
   {
-    return std::uniform_real_distribution<float>(from, to)(MT);
+    return from + (to - from) * MT.get_float();
   }
 
-  float get_random_float(std::mt19937 *MT, float from, float to)
+  float get_random_float(RNG *MT, float from, float to)
   {
     return get_random_float(*MT, from, to);
   }
 
-  int get_random_int(std::mt19937 &MT, int from, int to)
+  int get_random_int(RNG &MT, int from, int to)
   {
-    return std::uniform_int_distribution<int>(from, to)(MT);
+    // multiply-shift by the range, bias is negligible for small ranges
+    const auto range = uint64_t(to - from) + 1;
+    return from + int(((MT() >> 32) * range) >> 32);
   }
 
-  int get_random_int(std::mt19937 *MT, int from, int to)
+  int get_random_int(RNG *MT, int from, int to)
   {
     return get_random_int(*MT, from, to);
   }
@@ -80,4 +117,66 @@ namespace lacam
     return a;
   }
 
+  long get_peak_rss_kb()
+  {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return -1;
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;  // bytes on macOS
+#else
+    return usage.ru_maxrss;
+#endif
+  }
+
+  MappedFile::MappedFile(const std::string &filename)
+      : data(nullptr), size(0)
+  {
+    const auto fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+      auto addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (addr != MAP_FAILED) {
+        data = static_cast<const char *>(addr);
+        size = st.st_size;
+      }
+    }
+    close(fd);  // the mapping stays valid
+  }
+
+  MappedFile::~MappedFile()
+  {
+    if (data != nullptr) munmap(const_cast<char *>(data), size);
+  }
+
+  bool pop_line(std::string_view &buf, std::string_view &line)
+  {
+    if (buf.empty()) return false;
+    const auto pos = buf.find('\n');
+    line = buf.substr(0, pos);
+    buf.remove_prefix(pos == std::string_view::npos ? buf.size() : pos + 1);
+    if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+    return true;
+  }
+
+  std::string_view pop_field(std::string_view &buf)
+  {
+    const auto pos = buf.find('\t');
+    const auto field = buf.substr(0, pos);
+    buf.remove_prefix(pos == std::string_view::npos ? buf.size() : pos + 1);
+    return field;
+  }
+
+  bool parse_uint(std::string_view s, int &val)
+  {
+    if (s.empty() || s.size() > 9) return false;
+    auto res = 0;
+    for (auto c : s) {
+      if (c < '0' || '9' < c) return false;
+      res = res * 10 + (c - '0');
+    }
+    val = res;
+    return true;
+  }
+
 }  // namespace lacam
@@ -59,6 +59,10 @@ int main(int argc, char *argv[])
   program.add_argument("--pibt-num")
       .help("used in Monte-Carlo configuration generation")
       .default_value(std::string("10"));
+  program.add_argument("--batched-pibt")
+      .help("run the Monte-Carlo PIBTs in lockstep on a single thread")
+      .default_value(false)
+      .implicit_value(true);
   program.add_argument("--no-scatter")
       .help("turn off SUO")
       .default_value(false)
@@ -86,6 +90,36 @@ int main(int argc, char *argv[])
       .help("allow following conflicts")
       .default_value(false)
       .implicit_value(true);
+  program.add_argument("--lazy-dist-table")
+      .help("compute distances on demand, faster setup, more memory")
+      .default_value(false)
+      .implicit_value(true);
+  program.add_argument("--compress-dist-table")
+      .help("store distances as neighbor deltas, less memory, slower queries")
+      .default_value(false)
+      .implicit_value(true);
+  program.add_argument("--landmarks")
+      .help(
+          "number of landmarks, use lower bounds far from goals if positive; "
+          "less memory, but much worse solutions and longer searches")
+      .default_value(std::string("0"));
+  program.add_argument("--landmark-radius")
+      .help("exact distances within this radius of goals, with landmarks")
+      .default_value(std::string("20"));
+  program.add_argument("--dist-cache-dir")
+      .help("directory to persist distance tables across runs")
+      .default_value(std::string(""));
+  program.add_argument("--hilbert-order")
+      .help("number vertices along a Hilbert curve, for memory locality")
+      .default_value(false)
+      .implicit_value(true);
+  program.add_argument("--no-csr-layout")
+      .help("allocate each vertex and its adjacency separately, as before")
+      .default_value(false)
+      .implicit_value(true);
+  program.add_argument("--memory-limit")
+      .help("memory budget (MB) of the search, 0 -> unlimited")
+      .default_value(std::string("0"));
   try {
     program.parse_known_args(argc, argv);
   } catch (const std::runtime_error &err) {
@@ -104,6 +138,8 @@ int main(int argc, char *argv[])
   const auto output_name = program.get<std::string>("output");
   const auto log_short = program.get<bool>("log_short");
   const auto N = std::stoi(program.get<std::string>("num"));
+  Graph::FLG_HILBERT_ORDER = program.get<bool>("hilbert-order");
+  Graph::FLG_CSR_LAYOUT = !program.get<bool>("no-csr-layout");
   const auto ins = scen_name.size() > 0 ? Instance(scen_name, map_name, N)
                                         : Instance(map_name, N, seed);
   if (!ins.is_valid(1)) return 1;
@@ -115,6 +151,7 @@ int main(int argc, char *argv[])
       !program.get<bool>("no-multi-thread") && !flg_no_all;
   Planner::PIBT_NUM =
       flg_no_all ? 1 : std::stoi(program.get<std::string>("pibt-num"));
+  Planner::FLG_BATCHED_PIBT = program.get<bool>("batched-pibt");
   Planner::FLG_REFINER = !program.get<bool>("no-refiner") && !flg_no_all;
   Planner::REFINER_NUM = std::stoi(program.get<std::string>("refiner-num"));
   Planner::FLG_SCATTER = !program.get<bool>("no-scatter") && !flg_no_all;
@@ -137,6 +174,15 @@ int main(int argc, char *argv[])
   Planner::CHECKPOINTS_DURATION =
       std::stof(program.get<std::string>("checkpoints-duration")) * 1000;
   Planner::FLG_ALLOW_FOLLOWING = program.get<bool>("allow-following");
+  Planner::MEMORY_LIMIT =
+      std::stod(program.get<std::string>("memory-limit")) * 1024 * 1024;
+  DistTableMultiGoal::FLG_LAZY = program.get<bool>("lazy-dist-table");
+  DistTableMultiGoal::CACHE_DIR = program.get<std::string>("dist-cache-dir");
+  DistTableMultiGoal::FLG_COMPRESS = program.get<bool>("compress-dist-table");
+  DistTableMultiGoal::NUM_LANDMARKS =
+      std::stoi(program.get<std::string>("landmarks"));
+  DistTableMultiGoal::LANDMARK_RADIUS =
+      std::stoi(program.get<std::string>("landmark-radius"));
 
   // solve
   const auto deadline = Deadline(time_limit_sec * 1000);
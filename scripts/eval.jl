@@ -142,6 +142,7 @@ function main(config_files...)
             :search_iteration => 0,
             :num_high_level_node => 0,
             :num_low_level_node => 0,
+            :dist_table_setup_ms => 0,
             :num_open_vertices => count_vertices(map_file),
         )
         if isfile(output_file)
@@ -177,6 +178,8 @@ function main(config_files...)
                 !isnothing(m) && (row[:num_high_level_node] = parse(Int, m[1]))
                 m = match(r"num_low_level_node=(\d+)", line)
                 !isnothing(m) && (row[:num_low_level_node] = parse(Int, m[1]))
+                m = match(r"dist_table_setup_ms=(\d+)", line)
+                !isnothing(m) && (row[:dist_table_setup_ms] = parse(Int, m[1]))
             end
             rm(output_file)
         end
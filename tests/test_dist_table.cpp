@@ -1,4 +1,5 @@
 #include <cassert>
+#include <filesystem>
 #include <lacam.hpp>
 
 using namespace lacam;
@@ -15,5 +16,119 @@ int main()
     assert(dist_table.get(0, 0, ins.starts[0]) == 16);
   }
 
+  {
+    // lazy and eager evaluation give the same distances
+    const auto scen_filename = "../assets/random-32-32-10-random-1.scen";
+    const auto map_filename = "../assets/random-32-32-10.map";
+    const auto ins = Instance(scen_filename, map_filename, 20);
+    DistTableMultiGoal::FLG_LAZY = false;
+    auto D_eager = DistTableMultiGoal(ins);
+    DistTableMultiGoal::FLG_LAZY = true;
+    auto D_lazy = DistTableMultiGoal(ins);
+    DistTableMultiGoal::FLG_LAZY = false;
+    assert(D_lazy.get(0, 0, ins.starts[0]) == 16);
+    assert(!D_lazy.rows[0].complete);
+
+    // concurrent readers
+    auto pool = std::vector<std::future<void>>();
+    for (auto k = 0; k < 4; ++k) {
+      pool.emplace_back(std::async(std::launch::async, [&, k]() {
+        for (size_t i = 0; i < ins.N; ++i) {
+          for (auto v : ins.G->V) {
+            const auto v_id = (v->id + 97 * k) % ins.G->size();
+            assert(D_lazy.get(i, 0, v_id) == D_eager.get(i, 0, v_id));
+          }
+        }
+      }));
+    }
+    for (auto &f : pool) f.get();
+  }
+
+  {
+    // agents sharing goal vertices share rows
+    const auto map_filename = "../assets/random-32-32-10.map";
+    const std::vector<std::vector<int>> goal_sequences = {
+        {2, 3}, {3}, {2, 3, 2}};
+    const auto ins = Instance(map_filename, {0, 1, 4}, goal_sequences);
+    auto D = DistTableMultiGoal(ins);
+    assert(D.num_rows() == 2);
+    assert(D.narrow);
+    assert(D.get(0, 1, 3) == 0);
+    assert(D.get(1, 0, 2) == D.get(2, 2, 2) + 1);
+    assert(D.get(2, 5, 3) == D.get(0, 0, 3));  // capped at the last goal
+  }
+
+  {
+    // rows are persisted and mapped back
+    const auto scen_filename = "../assets/random-32-32-10-random-1.scen";
+    const auto map_filename = "../assets/random-32-32-10.map";
+    const auto ins = Instance(scen_filename, map_filename, 5);
+    const std::string cache_dir = "./dist_cache_test";
+    std::filesystem::remove_all(cache_dir);
+    DistTableMultiGoal::CACHE_DIR = cache_dir;
+    DistTableMultiGoal::FLG_LAZY = true;
+    auto D_cold = DistTableMultiGoal(ins);
+    assert(D_cold.num_cached_rows() == 0);
+    assert(D_cold.get(0, 0, ins.starts[0]) == 16);
+    auto D_warm = DistTableMultiGoal(ins);
+    assert(D_warm.num_cached_rows() == 1);  // only the queried row
+    for (auto v : ins.G->V) assert(D_warm.get(0, 0, v) == D_cold.get(0, 0, v));
+    for (size_t i = 0; i < ins.N; ++i) D_warm.get(i, 0, ins.starts[i]);
+    auto D_full = DistTableMultiGoal(ins);
+    assert(D_full.num_cached_rows() == ins.N);
+    DistTableMultiGoal::CACHE_DIR = "";
+    DistTableMultiGoal::FLG_LAZY = false;
+    std::filesystem::remove_all(cache_dir);
+  }
+
+  {
+    // compressed rows decode to the same distances
+    const auto scen_filename = "../assets/random-32-32-10-random-1.scen";
+    const auto map_filename = "../assets/random-32-32-10.map";
+    const auto ins = Instance(scen_filename, map_filename, 100);
+    DistTableMultiGoal::FLG_LAZY = false;
+    auto D_plain = DistTableMultiGoal(ins);
+    DistTableMultiGoal::FLG_COMPRESS = true;
+    auto D_eager = DistTableMultiGoal(ins);
+    DistTableMultiGoal::FLG_LAZY = true;
+    auto D_lazy = DistTableMultiGoal(ins);
+    DistTableMultiGoal::FLG_LAZY = false;
+    DistTableMultiGoal::FLG_COMPRESS = false;
+    assert(D_eager.compressed && D_lazy.compressed);
+    for (size_t i = 0; i < ins.N; ++i) {
+      for (auto v : ins.G->V) {
+        const auto d = D_plain.get(i, 0, v);
+        assert(D_eager.get(i, 0, v) == d);
+        assert(D_lazy.get(i, 0, v) == d);
+      }
+    }
+    assert(D_eager.bytes() * 4 < D_plain.bytes());
+  }
+
+  {
+    // landmarks give lower bounds, exact near goals
+    const auto scen_filename = "../assets/random-32-32-10-random-1.scen";
+    const auto map_filename = "../assets/random-32-32-10.map";
+    const auto ins = Instance(scen_filename, map_filename, 50);
+    auto D_exact = DistTableMultiGoal(ins);
+    DistTableMultiGoal::NUM_LANDMARKS = 8;
+    DistTableMultiGoal::LANDMARK_RADIUS = 5;
+    auto D = DistTableMultiGoal(ins);
+    DistTableMultiGoal::NUM_LANDMARKS = 0;
+    assert(D.landmarks.size() == 8);
+    auto num_exact = 0;
+    for (size_t i = 0; i < ins.N; ++i) {
+      for (auto v : ins.G->V) {
+        const auto d = D_exact.get(i, 0, v);
+        const auto lb = D.get(i, 0, v);
+        assert(lb <= d);
+        if (d <= 5) assert(lb == d);
+        num_exact += (lb == d);
+      }
+    }
+    assert(num_exact > 0);
+    DistTableMultiGoal::LANDMARK_RADIUS = 20;
+  }
+
   return 0;
 }
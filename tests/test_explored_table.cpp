@@ -0,0 +1,41 @@
+#include <cassert>
+#include <lacam.hpp>
+
+using namespace lacam;
+
+int main()
+{
+  {
+    const auto map_filename = "../assets/random-32-32-10.map";
+    const std::vector<std::vector<int>> goal_sequences = {{2}, {3}};
+    const auto ins = Instance(map_filename, {0, 1}, goal_sequences);
+    auto D = DistTableMultiGoal(ins);
+    const auto V_size = ins.G->size();
+
+    // enough entries to grow the table several times
+    auto T = ExploredTable(4);
+    auto nodes = std::vector<HNode *>();
+    for (auto k = 0; k < 5000; ++k) {
+      Config C({ins.G->V[k % V_size], ins.G->V[k / V_size]}, {0, 0});
+      C.hash = zobrist_hash(C);
+      const auto Q = PackedConfig(C);
+      assert(T.find(Q) == nullptr);
+      nodes.push_back(new HNode(Q, &D));
+      T.insert(nodes.back());
+    }
+    assert(T.size() == nodes.size());
+    for (auto H : nodes) assert(T.find(H->C) == H);
+
+    // same vertices, different goal indices
+    Config C({ins.G->V[0], ins.G->V[0]}, {1, 0});
+    C.hash = zobrist_hash(C);
+    assert(T.find(PackedConfig(C)) == nullptr);
+
+    auto cnt = 0;
+    T.for_each([&](HNode *) { ++cnt; });
+    assert(cnt == (int)nodes.size());
+    for (auto H : nodes) delete H;
+  }
+
+  return 0;
+}
@@ -28,6 +28,95 @@ int main()
 
     Config d = {G.V[1], G.V[0]};
     assert(has_following_conflict(a, d));
+
+    // packed version with a vertex-indexed scratch
+    auto occupied = std::vector<int>(G.size(), -1);
+    assert(!has_following_conflict(PackedConfig(a), PackedConfig(b), occupied));
+    assert(has_following_conflict(PackedConfig(a), PackedConfig(c), occupied));
+    assert(has_following_conflict(PackedConfig(a), PackedConfig(d), occupied));
+    for (auto k : occupied) assert(k == -1);
+  }
+
+  {
+    const std::string filename = "../assets/random-32-32-10.map";
+    auto G = Graph(filename);
+    Config a({G.V[0], G.V[1], G.V[2]}, {0, 1, 0});
+    a.hash = zobrist_hash(a);
+    Config b = a;
+    assert(ConfigHasher()(a) == ConfigHasher()(b));
+
+    // incremental update, only for agent-1
+    b[1] = G.V[3];
+    b.goal_indices[1] = 2;
+    b.hash ^= zobrist_key(1, a[1], a.goal_indices[1]) ^
+              zobrist_key(1, b[1], b.goal_indices[1]);
+    assert(b.hash == zobrist_hash(b));
+    assert(b.hash != a.hash);
+  }
+
+  {
+    const std::string filename = "../assets/random-32-32-10.map";
+    auto G = Graph(filename);
+    Config a({G.V[5], G.V[900], G.V[2]}, {0, 3, 1});
+    a.hash = zobrist_hash(a);
+    const auto p = PackedConfig(a);
+    assert(p.size() == 3);
+    assert(p.vertex_id(1) == 900);
+    assert(p.goal_index(1) == 3);
+    assert(p == PackedConfig(a));
+
+    Config b;
+    p.unpack(&G, b);
+    assert(a == b);
+    assert(a.hash == b.hash);
+  }
+
+  {
+    // Hilbert order keeps the grid, only ids change
+    const std::string filename = "../assets/random-32-32-10.map";
+    auto G_scan = Graph(filename);
+    Graph::FLG_HILBERT_ORDER = true;
+    auto G = Graph(filename);
+    Graph::FLG_HILBERT_ORDER = false;
+    assert(G.size() == G_scan.size());
+    auto num_adjacent = 0;
+    for (auto k = 0; k < G.size(); ++k) {
+      auto v = G.V[k];
+      assert(v->id == k);
+      assert(G.U[v->index] == v);
+      assert(G_scan.U[v->index] != nullptr);
+      assert(v->neighbor.size() == G_scan.U[v->index]->neighbor.size());
+      for (size_t j = 0; j < v->neighbor.size(); ++j) {
+        assert(v->neighbor[j]->index ==
+               G_scan.U[v->index]->neighbor[j]->index);
+      }
+      if (k > 0) {
+        auto u = G.V[k - 1];
+        num_adjacent += (std::abs(u->x - v->x) + std::abs(u->y - v->y) == 1);
+      }
+    }
+    assert(num_adjacent > G.size() * 3 / 4);  // mostly consecutive cells
+  }
+
+  {
+    // the previous layout gives the same graph
+    const std::string filename = "../assets/random-32-32-10.map";
+    auto G_csr = Graph(filename);
+    Graph::FLG_CSR_LAYOUT = false;
+    auto G = Graph(filename);
+    Graph::FLG_CSR_LAYOUT = true;
+    assert(G.vertices.empty() && G.adj_ptr.empty());
+    assert(G.size() == G_csr.size());
+    assert(G.adj == G_csr.adj && G.adj_offset == G_csr.adj_offset);
+    for (auto k = 0; k < G.size(); ++k) {
+      auto v = G.V[k];
+      assert(v->id == k && v->index == G_csr.V[k]->index);
+      assert(v->candidates.size() == G_csr.V[k]->candidates.size());
+      for (size_t j = 0; j < v->candidates.size(); ++j) {
+        assert(v->candidates[j]->id == G_csr.V[k]->candidates[j]->id);
+      }
+      assert(v->candidates[v->neighbor.size()] == v);
+    }
   }
 
   return 0;
@@ -32,5 +32,61 @@ int main()
     assert(ins.goal_sequences[1].back()->index == 7);
   }
 
+  {
+    // CRLF line endings give the same instance
+    const auto scen_filename = "../assets/random-32-32-10-random-1.scen";
+    const auto map_filename = "../assets/random-32-32-10.map";
+    const auto crlf = [](const std::string &src, const std::string &dst) {
+      std::ifstream in(src);
+      std::ofstream out(dst);
+      std::string line;
+      while (getline(in, line)) out << line << "\r\n";
+    };
+    crlf(scen_filename, "./crlf.scen");
+    crlf(map_filename, "./crlf.map");
+    const auto ins_lf = Instance(scen_filename, map_filename, 10);
+    const auto ins_crlf = Instance("./crlf.scen", "./crlf.map", 10);
+
+    assert(ins_crlf.G->size() == ins_lf.G->size());
+    assert(size(ins_crlf.starts) == 10);
+    for (auto i = 0; i < 10; ++i) {
+      assert(ins_crlf.starts[i]->index == ins_lf.starts[i]->index);
+      assert(ins_crlf.goal_sequences[i].back()->index ==
+             ins_lf.goal_sequences[i].back()->index);
+    }
+    std::remove("./crlf.scen");
+    std::remove("./crlf.map");
+  }
+
+  {
+    // random instances do not depend on the vertex numbering
+    const auto map_filename = "../assets/random-32-32-10.map";
+    const auto ins = Instance(map_filename, 20, 1);
+    Graph::FLG_HILBERT_ORDER = true;
+    const auto ins_hilbert = Instance(map_filename, 20, 1);
+    Graph::FLG_HILBERT_ORDER = false;
+    for (auto i = 0; i < 20; ++i) {
+      assert(ins.starts[i]->index == ins_hilbert.starts[i]->index);
+      assert(ins.goal_sequences[i][0]->index ==
+             ins_hilbert.goal_sequences[i][0]->index);
+    }
+  }
+
+  {
+    // goal sequences beyond the limit of PackedConfig are rejected
+    const auto map_filename = "../assets/empty-8-8.map";
+    auto goals = std::vector<int>();
+    for (auto k = 0; k < PackedConfig::MAX_GOAL_INDEX; ++k) {
+      goals.push_back(1 + k % 2);
+    }
+    using GoalSequences = std::vector<std::vector<int>>;
+    const auto ins_ok = Instance(map_filename, {0}, GoalSequences{goals});
+    assert(ins_ok.is_valid());
+    goals.push_back(3);
+    const auto ins = Instance(map_filename, {0}, GoalSequences{goals});
+    assert(!ins.is_valid());
+    assert(solve(ins).empty());
+  }
+
   return 0;
 }
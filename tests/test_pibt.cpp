@@ -0,0 +1,393 @@
+#include <cassert>
+#include <lacam.hpp>
+
+using namespace lacam;
+
+// PIBT with recursive priority inheritance, as originally written;
+// a reference for the iterative version.
+// With legacy_rng, tie-breakers are drawn as in the original mt19937 version,
+// otherwise in the same order as PIBT, hence the same trajectories.
+struct RecursivePIBT {
+  const Instance *ins;
+  DistTableMultiGoal *D;
+  Scatter *scatter;
+  const bool allow_following;
+  const bool legacy_rng;
+  RNG MT_calls;
+  RNG MT;
+  std::mt19937 MT_legacy;
+  const int N;
+  const int NO_AGENT;
+  std::vector<int> occupied_now;
+  std::vector<int> occupied_next;
+  std::vector<std::array<Vertex *, 5>> C_next;
+  std::vector<float> tie_breakers;
+
+  RecursivePIBT(const Instance *_ins, DistTableMultiGoal *_D, int seed,
+                Scatter *_scatter, bool _allow_following, int stream,
+                bool _legacy_rng = false)
+      : ins(_ins),
+        D(_D),
+        scatter(_scatter),
+        allow_following(_allow_following),
+        legacy_rng(_legacy_rng),
+        MT_calls(seed, stream),
+        MT(),
+        MT_legacy(seed),
+        N(ins->N),
+        NO_AGENT(N),
+        occupied_now(ins->G->size(), NO_AGENT),
+        occupied_next(ins->G->size(), NO_AGENT),
+        C_next(N),
+        tie_breakers(ins->G->size(), 0)
+  {
+  }
+
+  bool set_new_config(const Config &Q_from, Config &Q_to,
+                      const std::vector<int> &order)
+  {
+    if (!legacy_rng) MT = RNG(MT_calls());
+    bool success = true;
+    for (auto i = 0; i < N; ++i) occupied_now[Q_from[i]->id] = i;
+    for (auto i = 0; i < N; ++i) {
+      if (Q_to[i] == nullptr) continue;
+      const auto j = occupied_now[Q_to[i]->id];
+      if (occupied_next[Q_to[i]->id] != NO_AGENT ||
+          (allow_following && j != NO_AGENT && j != i &&
+           Q_to[j] == Q_from[i]) ||
+          (!allow_following && j != NO_AGENT && j != i)) {
+        success = false;
+        break;
+      }
+      occupied_next[Q_to[i]->id] = i;
+    }
+    if (success) {
+      for (auto i : order) {
+        if (Q_to[i] == nullptr && !funcPIBT(i, NO_AGENT, Q_from, Q_to)) {
+          success = false;
+          break;
+        }
+      }
+    }
+    for (auto i = 0; i < N; ++i) {
+      occupied_now[Q_from[i]->id] = NO_AGENT;
+      if (Q_to[i] != nullptr) occupied_next[Q_to[i]->id] = NO_AGENT;
+    }
+    return success;
+  }
+
+  int set_candidates(const int i, const int i_caller, const Config &Q_from)
+  {
+    const auto &cands = Q_from[i]->candidates;  // neighbors, then itself
+    const auto K = cands.size() - 1;
+    size_t num_candidates = K;
+    if (i_caller == NO_AGENT || allow_following) num_candidates++;
+    if (legacy_rng) {
+      for (size_t k = 0; k < K; ++k) {
+        tie_breakers[cands[k]->id] =
+            std::uniform_real_distribution<float>(0, 1)(MT_legacy);
+      }
+    } else {
+      float rands[5];
+      MT.get_floats(rands, num_candidates);
+      for (size_t k = 0; k < num_candidates; ++k) {
+        tie_breakers[cands[k]->id] = rands[k];
+      }
+    }
+    std::copy(cands.begin(), cands.begin() + num_candidates,
+              C_next[i].begin());
+
+    Vertex *prioritized_vertex = nullptr;
+    if (scatter != nullptr) {
+      const auto &data_for_this_goal =
+          scatter->scatter_data_labeled[i][Q_from.goal_indices[i]];
+      auto itr_s = data_for_this_goal.find(Q_from[i]->id);
+      if (itr_s != data_for_this_goal.end()) prioritized_vertex = itr_s->second;
+    }
+    auto compare = [&](Vertex *const v, Vertex *const u) {
+      if (v == prioritized_vertex) return u != prioritized_vertex;
+      if (u == prioritized_vertex) return false;
+      return D->get(i, Q_from.goal_indices[i], v) + tie_breakers[v->id] <
+             D->get(i, Q_from.goal_indices[i], u) + tie_breakers[u->id];
+    };
+    if (legacy_rng) {
+      std::sort(C_next[i].begin(), C_next[i].begin() + num_candidates,
+                compare);
+    } else {
+      std::stable_sort(C_next[i].begin(), C_next[i].begin() + num_candidates,
+                       compare);
+    }
+    return num_candidates;
+  }
+
+  bool funcPIBT(const int i, const int i_caller, const Config &Q_from,
+                Config &Q_to)
+  {
+    const auto num_candidates = set_candidates(i, i_caller, Q_from);
+    for (auto k = 0; k < num_candidates; ++k) {
+      auto u = C_next[i][k];
+      if (occupied_next[u->id] != NO_AGENT) continue;
+      const auto j = occupied_now[u->id];
+      if (allow_following) {
+        if (j != NO_AGENT && Q_to[j] == Q_from[i]) continue;
+        occupied_next[u->id] = i;
+        Q_to[i] = u;
+        if (j != NO_AGENT && u != Q_from[i] && Q_to[j] == nullptr &&
+            !funcPIBT(j, NO_AGENT, Q_from, Q_to))
+          continue;
+        return true;
+      } else {
+        if (j != NO_AGENT && j != i) {
+          if (Q_to[j] == nullptr) {
+            if (occupied_next[Q_from[i]->id] != NO_AGENT) return false;
+            occupied_next[Q_from[i]->id] = i;
+            Q_to[i] = Q_from[i];
+            if (funcPIBT(j, i, Q_from, Q_to)) return true;
+            occupied_next[Q_from[i]->id] = NO_AGENT;
+            Q_to[i] = nullptr;
+          }
+          continue;
+        }
+        occupied_next[u->id] = i;
+        Q_to[i] = u;
+        return true;
+      }
+    }
+    occupied_next[Q_from[i]->id] = i;
+    Q_to[i] = Q_from[i];
+    return false;
+  }
+};
+
+// farther agents first, same as the initial priorities of the planner
+static void set_order(const Instance &ins, DistTableMultiGoal &D,
+                      const Config &Q, std::vector<int> &order)
+{
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](int i, int j) {
+    return D.get(i, 0, Q[i]) > D.get(j, 0, Q[j]);
+  });
+}
+
+// roll out PIBT for T steps and hash the trajectory
+static uint64_t rollout(const Instance &ins, DistTableMultiGoal &D,
+                        Scatter *scatter, bool allow_following, const int T)
+{
+  auto pibt = PIBT(&ins, &D, 0, scatter, allow_following);
+  const auto N = ins.N;
+  auto Q_from = ins.starts;
+  auto order = std::vector<int>(N);
+  uint64_t checksum = 0;
+  for (auto t = 0; t < T; ++t) {
+    set_order(ins, D, Q_from, order);
+    auto Q_to = Config(N, nullptr);
+    const auto res = pibt.set_new_config(Q_from, Q_to, order);
+    checksum = checksum * 1000003 + res;
+    if (!res) continue;
+    for (size_t i = 0; i < N; ++i) checksum = checksum * 1000003 + Q_to[i]->id;
+    for (size_t i = 0; i < N; ++i) Q_from[i] = Q_to[i];
+  }
+  return checksum;
+}
+
+// the iterative PIBT follows the recursive one step by step
+static void check_recursive(const Instance &ins, DistTableMultiGoal &D,
+                            Scatter *scatter, bool allow_following,
+                            const int T, const int seed)
+{
+  const auto N = ins.N;
+  auto pibt = PIBT(&ins, &D, seed, scatter, allow_following, 1);
+  auto ref = RecursivePIBT(&ins, &D, seed, scatter, allow_following, 1);
+  auto Q_from = ins.starts;
+  auto order = std::vector<int>(N);
+  auto num_success = 0;
+  for (auto t = 0; t < T; ++t) {
+    set_order(ins, D, Q_from, order);
+    auto Q_to = Config(N, nullptr);
+    auto Q_to_ref = Config(N, nullptr);
+    // with a constraint on the first agent every third step
+    if (t % 3 == 2) Q_to[0] = Q_to_ref[0] = Q_from[0]->neighbor[0];
+    const auto res = pibt.set_new_config(Q_from, Q_to, order);
+    assert(res == ref.set_new_config(Q_from, Q_to_ref, order));
+    if (!res) continue;
+    ++num_success;
+    for (size_t i = 0; i < N; ++i) assert(Q_to[i] == Q_to_ref[i]);
+    for (size_t i = 0; i < N; ++i) Q_from[i] = Q_to[i];
+  }
+  assert(num_success > 0);
+}
+
+// with the tie-breakers of the original version, trajectories diverge;
+// both remain feasible and make similar progress
+static int rollout_progress(const Instance &ins, DistTableMultiGoal &D,
+                            bool allow_following, const int T,
+                            const int seed, const bool legacy)
+{
+  const auto N = ins.N;
+  auto pibt = PIBT(&ins, &D, seed, nullptr, allow_following);
+  auto ref = RecursivePIBT(&ins, &D, seed, nullptr, allow_following, 0, true);
+  auto solution = Solution({ins.starts});
+  auto order = std::vector<int>(N);
+  for (auto t = 0; t < T; ++t) {
+    const auto &Q_from = solution.back();
+    set_order(ins, D, Q_from, order);
+    auto Q_to = Config(N, nullptr);
+    const auto res = legacy ? ref.set_new_config(Q_from, Q_to, order)
+                            : pibt.set_new_config(Q_from, Q_to, order);
+    assert(res);
+    solution.push_back(Q_to);
+  }
+  assert(is_feasible_solution(ins, solution, 0, allow_following));
+  auto sum_of_dist = 0;
+  for (size_t i = 0; i < N; ++i) sum_of_dist += D.get(i, 0, solution[T][i]);
+  return sum_of_dist;
+}
+
+// lanes of BatchedPIBT must match independent PIBTs of the same streams
+static void check_batched(const Instance &ins, DistTableMultiGoal &D,
+                          Scatter *scatter, bool allow_following, const int T)
+{
+  const auto N = ins.N;
+  const auto K = 4;
+  auto pibts = std::vector<PIBT>();
+  for (auto k = 0; k < K; ++k) {
+    pibts.emplace_back(&ins, &D, 0, scatter, allow_following, k + 1);
+  }
+  auto batched = BatchedPIBT(&ins, &D, K, 0, scatter, allow_following, 1);
+  auto Q_from = ins.starts;
+  auto order = std::vector<int>(N);
+  std::iota(order.begin(), order.end(), 0);
+  auto Q_tos = std::vector<Config>(K, Config(N, nullptr));
+  auto success = std::vector<bool>();
+  for (auto t = 0; t < T; ++t) {
+    // with a constraint on the first agent every other step
+    std::fill(Q_tos[0].begin(), Q_tos[0].end(), nullptr);
+    if (t % 2 == 1) Q_tos[0][0] = Q_from[0]->neighbor[0];
+    auto Q_constraints = Q_tos[0];
+    batched.set_new_configs(Q_from, Q_tos, order, success);
+    auto next = -1;
+    for (auto k = 0; k < K; ++k) {
+      auto Q_to = Q_constraints;
+      const auto res = pibts[k].set_new_config(Q_from, Q_to, order);
+      assert(res == success[k]);
+      if (!res) continue;
+      for (size_t i = 0; i < N; ++i) assert(Q_to[i] == Q_tos[k][i]);
+      if (next == -1) next = k;
+    }
+    if (next != -1) {
+      for (size_t i = 0; i < N; ++i) Q_from[i] = Q_tos[next][i];
+    }
+  }
+}
+
+// cancelled candidates never win, nor do they shift later calls;
+// the others match the recursive PIBT without cancellation
+static void check_cancellation(const Instance &ins, DistTableMultiGoal &D,
+                               bool allow_following, const int T)
+{
+  const auto N = ins.N;
+  const auto K = 4;
+  auto cancellation = PIBT::Cancellation();
+  auto pibts = std::vector<PIBT>();
+  auto pibts_ref = std::vector<RecursivePIBT>();
+  for (auto k = 0; k < K; ++k) {
+    pibts.emplace_back(&ins, &D, 0, nullptr, allow_following, k + 1);
+    pibts.back().cancellation = &cancellation;
+    pibts_ref.emplace_back(&ins, &D, 0, nullptr, allow_following, k + 1);
+  }
+  auto Q_from = ins.starts;
+  auto order = std::vector<int>(N);
+  std::iota(order.begin(), order.end(), 0);
+  auto num_cancelled = 0;
+  for (auto t = 0; t < T; ++t) {
+    cancellation.reset();
+    auto best = Config();
+    auto f_best = INT_MAX;
+    for (auto k = 0; k < K; ++k) {
+      auto Q_to = Config(N, nullptr);
+      auto Q_to_ref = Config(N, nullptr);
+      const auto res = pibts[k].set_new_config(Q_from, Q_to, order);
+      const auto res_ref = pibts_ref[k].set_new_config(Q_from, Q_to_ref, order);
+      assert(!res || res_ref);
+      if (!res_ref) continue;
+      auto f = 0;
+      for (size_t i = 0; i < N; ++i) {
+        f += pibts[k].get_cost(i, Q_from, Q_to_ref);
+      }
+      if (res) {
+        for (size_t i = 0; i < N; ++i) assert(Q_to[i] == Q_to_ref[i]);
+        cancellation.update(f, pibts[k].id);
+      } else {
+        assert(f >= f_best);
+        ++num_cancelled;
+      }
+      if (f < f_best) {
+        f_best = f;
+        best = Q_to_ref;
+      }
+    }
+    if (f_best == INT_MAX) continue;
+    for (size_t i = 0; i < N; ++i) Q_from[i] = best[i];
+  }
+  assert(num_cancelled > 0);
+
+  // failed constraints stop the others
+  auto Q_to = Config(N, nullptr);
+  Q_to[0] = Q_to[1] = Q_from[0];
+  cancellation.reset();
+  assert(!pibts[0].set_new_config(Q_from, Q_to, order));
+  assert(cancellation.is_hopeless(0, 0));
+}
+
+int main()
+{
+  // trajectories are fixed for a given seed
+  const auto scen_filename = "../assets/random-32-32-10-random-1.scen";
+  const auto map_filename = "../assets/random-32-32-10.map";
+  const auto T = 50;
+  {
+    const auto ins = Instance(scen_filename, map_filename, 100);
+    auto D = DistTableMultiGoal(&ins);
+    assert(rollout(ins, D, nullptr, false, T) ==
+           13190547868007119943ULL);
+    assert(rollout(ins, D, nullptr, true, T) ==
+           3995519599915613321ULL);
+  }
+  {
+    const auto ins = Instance(scen_filename, map_filename, 400);
+    auto D = DistTableMultiGoal(&ins);
+    assert(rollout(ins, D, nullptr, false, T) ==
+           14086349401359992996ULL);
+    assert(rollout(ins, D, nullptr, true, T) ==
+           10938435138962212035ULL);
+
+    auto scatter = Scatter(&ins, &D, nullptr, 0, 0);
+    scatter.construct();
+    assert(rollout(ins, D, &scatter, false, T) ==
+           17971630354005691868ULL);
+
+    for (auto seed = 0; seed < 3; ++seed) {
+      check_recursive(ins, D, nullptr, false, T, seed);
+      check_recursive(ins, D, nullptr, true, T, seed);
+      check_recursive(ins, D, &scatter, false, T, seed);
+    }
+    for (auto allow_following : {false, true}) {
+      auto d = 0;
+      auto d_legacy = 0;
+      for (auto seed = 0; seed < 3; ++seed) {
+        d += rollout_progress(ins, D, allow_following, T, seed, false);
+        d_legacy += rollout_progress(ins, D, allow_following, T, seed, true);
+      }
+      assert(d * 10 <= d_legacy * 11);
+    }
+
+    check_batched(ins, D, nullptr, false, T);
+    check_batched(ins, D, nullptr, true, T);
+    check_batched(ins, D, &scatter, false, T);
+
+    check_cancellation(ins, D, false, T);
+    check_cancellation(ins, D, true, T);
+  }
+
+  return 0;
+}
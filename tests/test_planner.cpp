@@ -79,5 +79,61 @@ int main()
     assert(is_feasible_solution(ins, solution, threshold, VERBOSITY));
   }
 
+  // landmark distance table, with lower bounds far from goals
+  {
+    const auto scen_filename = "../assets/random-32-32-10-random-1.scen";
+    const auto map_filename = "../assets/random-32-32-10.map";
+    const auto ins = Instance(scen_filename, map_filename, 50);
+    assert(ins.is_valid(VERBOSITY));
+    const auto threshold = std::nullopt;
+
+    Planner::FLG_SCATTER = false;
+    DistTableMultiGoal::NUM_LANDMARKS = 8;
+    DistTableMultiGoal::LANDMARK_RADIUS = 10;
+    auto planner = Planner(&ins, threshold, VERBOSITY, nullptr, 0);
+    auto solution = planner.solve();
+    assert(planner.D->landmarks.size() == 8);
+    DistTableMultiGoal::NUM_LANDMARKS = 0;
+    DistTableMultiGoal::LANDMARK_RADIUS = 20;
+    Planner::FLG_SCATTER = true;
+    assert(solution.size() > 0);
+    assert(is_feasible_solution(ins, solution, threshold, VERBOSITY));
+  }
+
+  // memory-bounded search
+  {
+    const auto scen_filename = "../assets/random-32-32-10-random-1.scen";
+    const auto map_filename = "../assets/random-32-32-10.map";
+    const auto ins = Instance(scen_filename, map_filename, 100);
+    assert(ins.is_valid(VERBOSITY));
+    const auto threshold = std::nullopt;
+    Planner::FLG_SCATTER = false;
+
+    // low-level search data are released, then the search continues
+    Planner::MEMORY_LIMIT = 320 * 1024;
+    {
+      auto planner = Planner(&ins, threshold, VERBOSITY, nullptr, 0);
+      auto solution = planner.solve();
+      assert(planner.num_memory_reductions > 0);
+      assert(!planner.memory_limit_reached);
+      assert(planner.get_memory_usage() < Planner::MEMORY_LIMIT);
+      assert(solution.size() > 0);
+      assert(is_feasible_solution(ins, solution, threshold, VERBOSITY));
+    }
+
+    // releasing is not enough, the search stops without a solution
+    Planner::MEMORY_LIMIT = 256 * 1024;
+    {
+      auto planner = Planner(&ins, threshold, VERBOSITY, nullptr, 0);
+      auto solution = planner.solve();
+      assert(planner.num_memory_reductions > 0);
+      assert(planner.memory_limit_reached);
+      assert(solution.empty());
+    }
+
+    Planner::MEMORY_LIMIT = 0;
+    Planner::FLG_SCATTER = true;
+  }
+
   return 0;
 }
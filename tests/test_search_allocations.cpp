@@ -0,0 +1,125 @@
+#include <atomic>
+#include <cassert>
+#include <cstdlib>
+#include <lacam.hpp>
+#include <new>
+
+using namespace lacam;
+
+// counting allocator
+static std::atomic<long> NUM_ALLOCATIONS(0);
+
+void *operator new(std::size_t size)
+{
+  ++NUM_ALLOCATIONS;
+  if (auto p = std::malloc(size == 0 ? 1 : size)) return p;
+  throw std::bad_alloc();
+}
+void *operator new[](std::size_t size) { return operator new(size); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+
+int main()
+{
+  Planner::FLG_SCATTER = false;
+
+  // generating and looking up a configuration does not allocate
+  {
+    const auto scen_filename = "../assets/random-32-32-10-random-1.scen";
+    const auto map_filename = "../assets/random-32-32-10.map";
+    const auto ins = Instance(scen_filename, map_filename, 50);
+    assert(ins.is_valid(0));
+
+    auto planner = Planner(&ins);
+    auto C_init = ins.starts;
+    C_init.hash = zobrist_hash(C_init);
+    calculate_goal_indices(&ins, C_init, C_init);
+    auto H = planner.create_highlevel_node(PackedConfig(C_init), nullptr);
+    planner.set_pibt();
+
+    // low-level nodes are stored in the high-level node
+    auto MT = RNG(0);
+    auto L_list = std::vector<LNode *>();
+    for (auto k = 0; k < 20; ++k) {
+      L_list.push_back(H->get_next_lowlevel_node(MT, ins.G, planner.D));
+    }
+
+    auto iteration = [&](LNode *L) {
+      if (!planner.set_new_config(H, L, planner.Q_to)) return;
+      calculate_goal_indices(&ins, planner.Q_to, planner.Q_from);
+      planner.Q_to_packed.pack(planner.Q_to);
+      auto H_known = planner.EXPLORED.find(planner.Q_to_packed);
+      if (H_known != nullptr) planner.rewrite(H, H_known);
+    };
+    iteration(L_list.front());  // warm-up
+
+    const auto num_allocations_before = NUM_ALLOCATIONS.load();
+    assert(num_allocations_before > 0);
+    for (auto L : L_list) iteration(L);
+    assert(NUM_ALLOCATIONS.load() == num_allocations_before);
+
+    planner.EXPLORED.for_each(
+        [&](HNode *n) { planner.hnode_pool.dispose(n); });
+  }
+
+  // allocations of whole search iterations are bounded;
+  // new high-level nodes own a few vectors, the rest amortizes
+  {
+    const auto scen_filename = "../assets/random-32-32-10-random-1.scen";
+    const auto map_filename = "../assets/random-32-32-10.map";
+    const auto ins = Instance(scen_filename, map_filename, 50);
+    assert(ins.is_valid(0));
+
+    auto planner = Planner(&ins);
+    auto C_init = ins.starts;
+    C_init.hash = zobrist_hash(C_init);
+    calculate_goal_indices(&ins, C_init, C_init);
+    planner.OPEN.push_front(
+        planner.create_highlevel_node(PackedConfig(C_init), nullptr));
+    planner.set_pibt();
+
+    // the loop of Planner::solve, without goal checks
+    auto MT = RNG(0);
+    auto num_new_nodes = 0;
+    auto num_other_iterations = 0;
+    auto max_allocations_per_iteration = 0L;
+    const auto num_allocations_before = NUM_ALLOCATIONS.load();
+    for (auto k = 0; k < 20000 && !planner.OPEN.empty(); ++k) {
+      const auto num_allocations_iter = NUM_ALLOCATIONS.load();
+      auto H = planner.OPEN.front();
+      auto L = H->get_next_lowlevel_node(MT, ins.G, planner.D);
+      if (L == nullptr) {
+        planner.OPEN.pop_front();
+      } else if (planner.set_new_config(H, L, planner.Q_to)) {
+        calculate_goal_indices(&ins, planner.Q_to, planner.Q_from);
+        planner.Q_to_packed.pack(planner.Q_to);
+        auto H_known = planner.EXPLORED.find(planner.Q_to_packed);
+        if (H_known != nullptr) {
+          planner.rewrite(H, H_known);
+          planner.OPEN.push_front(H_known);
+        } else {
+          planner.OPEN.push_front(
+              planner.create_highlevel_node(planner.Q_to_packed, H));
+          ++num_new_nodes;
+          --num_other_iterations;
+        }
+      }
+      ++num_other_iterations;
+      max_allocations_per_iteration =
+          std::max(max_allocations_per_iteration,
+                   NUM_ALLOCATIONS.load() - num_allocations_iter);
+    }
+    const auto num_allocations =
+        NUM_ALLOCATIONS.load() - num_allocations_before;
+    assert(num_new_nodes > 1000 && num_other_iterations > 1000);
+    assert(max_allocations_per_iteration <= 12);
+    assert(num_allocations <= 7 * num_new_nodes + num_other_iterations / 2);
+
+    planner.EXPLORED.for_each(
+        [&](HNode *n) { planner.hnode_pool.dispose(n); });
+  }
+
+  return 0;
+}
@@ -0,0 +1,41 @@
+#include <atomic>
+#include <cassert>
+#include <lacam.hpp>
+
+using namespace lacam;
+
+int main()
+{
+  // back-to-back batches; each batch lives on the caller's stack only
+  // until its last task is reported
+  {
+    auto pool = ThreadPool(3, false);
+    for (auto i = 0; i < 20000; ++i) {
+      const auto n = 1 + i % 5;
+      auto sum = std::atomic<int>(0);
+      pool.run(n, [&](int k) { sum += k + 1; });
+      assert(sum == n * (n + 1) / 2);
+    }
+  }
+
+  // multiple callers sharing the pool
+  {
+    auto pool = ThreadPool(2, false);
+    auto callers = std::vector<std::thread>();
+    auto failures = std::atomic<int>(0);
+    for (auto c = 0; c < 3; ++c) {
+      callers.emplace_back([&] {
+        for (auto i = 0; i < 5000; ++i) {
+          const auto n = 1 + i % 4;
+          auto cnt = std::atomic<int>(0);
+          pool.run(n, [&](int) { ++cnt; });
+          if (cnt != n) ++failures;
+        }
+      });
+    }
+    for (auto &th : callers) th.join();
+    assert(failures == 0);
+  }
+
+  return 0;
+}